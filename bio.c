@@ -1,7 +1,9 @@
 // Buffer cache.
 //
 // The buffer cache is a linked list of buf structures holding
-// cached copies of disk block contents.  Caching disk blocks
+// cached copies of disk block contents.  It starts with NBUF
+// buffers and grows from the slab allocator when every buffer
+// is in use.  Caching disk blocks
 // in memory reduces the number of disk reads and also provides
 // a synchronization point for disk blocks used by multiple processes.
 // 
@@ -24,35 +26,54 @@
 #include "defs.h"
 #include "param.h"
 #include "spinlock.h"
+#include "slab.h"
+#include "mmu.h"
+#include "wait.h"
+#include "signal.h"
+#include "proc.h"
 #include "buf.h"
 
 struct {
   struct spinlock lock;
-  struct buf buf[NBUF];
+  struct kmem_cache cache;
 
   // Linked list of all buffers, through prev/next.
   // head.next is most recently used.
   struct buf head;
 } bcache;
 
+// Allocate a new buffer and put it at the head of the list.
+// Caller must hold bcache.lock (or be binit).
+static struct buf*
+bnew(void)
+{
+  struct buf *b;
+
+  if((b = kmem_cache_alloc(&bcache.cache)) == 0)
+    return 0;
+  b->next = bcache.head.next;
+  b->prev = &bcache.head;
+  b->dev = -1;
+  bcache.head.next->prev = b;
+  bcache.head.next = b;
+  return b;
+}
+
 void
 binit(void)
 {
-  struct buf *b;
+  int i;
 
   initlock(&bcache.lock, "bcache");
+  kmem_cache_init(&bcache.cache, "buf", sizeof(struct buf));
 
 //PAGEBREAK!
   // Create linked list of buffers
   bcache.head.prev = &bcache.head;
   bcache.head.next = &bcache.head;
-  for(b = bcache.buf; b < bcache.buf+NBUF; b++){
-    b->next = bcache.head.next;
-    b->prev = &bcache.head;
-    b->dev = -1;
-    bcache.head.next->prev = b;
-    bcache.head.next = b;
-  }
+  for(i = 0; i < NBUF; i++)
+    if(bnew() == 0)
+      panic("binit");
 }
 
 // Look through buffer cache for sector on device dev.
@@ -91,7 +112,15 @@ bget(uint dev, uint sector)
       return b;
     }
   }
-  panic("bget: no buffers");
+
+  // Every buffer is busy or dirty; grow the cache.
+  if((b = bnew()) == 0)
+    panic("bget: no buffers");
+  b->dev = dev;
+  b->sector = sector;
+  b->flags = B_BUSY;
+  release(&bcache.lock);
+  return b;
 }
 
 // Return a B_BUSY buf with the contents of the indicated disk sector.
@@ -101,8 +130,11 @@ bread(uint dev, uint sector)
   struct buf *b;
 
   b = bget(dev, sector);
-  if(!(b->flags & B_VALID))
+  if(!(b->flags & B_VALID)){
     iderw(b);
+    if(proc)
+      proc->ru.inblock++;
+  }
   return b;
 }
 
@@ -114,6 +146,8 @@ bwrite(struct buf *b)
     panic("bwrite");
   b->flags |= B_DIRTY;
   iderw(b);
+  if(proc)
+    proc->ru.oublock++;
 }
 
 // Release a B_BUSY buffer.
@@ -11,13 +11,13 @@
 #include "file.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "wait.h"
+#include "signal.h"
 #include "proc.h"
 #include "x86.h"
 
-#include "history.h"
-#include "var_in_kernel.h"
-
 static void consputc(int);
+static void cgasync(void);
 
 static int panicked = 0;
 
@@ -101,6 +101,7 @@ cprintf(char *fmt, ...)
     }
   }
 
+  cgasync();
   if(locking)
     release(&cons.lock);
 }
@@ -113,6 +114,7 @@ panic(char *s)
   
   cli();
   cons.locking = 0;
+  uartpanic();
   cprintf("cpu%d: panic: ", cpu->id);
   cprintf(s);
   cprintf("\n");
@@ -135,58 +137,200 @@ panic(char *s)
 #define KEY_PGDN        0xE7
 #define KEY_INS         0xE8
 #define KEY_DEL         0xE9
+#define KEY_WLF         0x101  // word left, from ESC b
+#define KEY_WRT         0x102  // word right, from ESC f
 
 #define BACKSPACE 0x100
 #define CRTPORT 0x3d4
 static ushort *crt = (ushort*)P2V(0xb8000);  // CGA memory
 
-#define INPUT_BUF 128
+#define EDITBUF 1024   // longest line that can be typed, plus 1
+
+// Finished lines wait in buf[r..w) for consoleread().
+#define INPUT_BUF 2048
 struct {
   struct spinlock lock;
   char buf[INPUT_BUF];
   uint r;  // Read index
   uint w;  // Write index
-  uint e;  // Edit index
-
-  uint l;  // Input length
-  uint m;  // Mode 0,INSERT 1,REPLACE
+  char hbuf[EDITBUF];  // a history command being looked at
 } input;
 
 #define C(x)  ((x)-'@')  // Control-x
 
+// Foreground process group: the only processes that may read
+// the console, and the target of ^C and ^Z.  0 if none.
+// ctlpgrp is the group that controls the console, the first to
+// set the foreground (the login shell); it and the foreground
+// group may change it.  A shell at its prompt makes its own
+// group the foreground, which fgself then notes.
+static int fgpgrp;
+static int ctlpgrp;
+static int fgself;  // the foreground group set itself
+
 #define WHITE_ON_BLACK 0x0700
 
 void consputc(int c);
 
+// The screen is a window onto a ring of NSCROLL lines, and output
+// and the line editor write into the ring, marking window rows
+// dirty; cgasync() copies just the dirty rows to CGA memory and
+// moves the hardware cursor, once per write.  Scrolling moves the
+// window down the ring rather than moving text, so however many
+// lines a write scrolls, each screen row is copied at most once.
+// PgUp and PgDn show earlier parts of the ring; any change to the
+// screen goes back to the live window.  The ring and cgapos are
+// guarded by cons.lock.
+#define NSCROLL 2048   // lines kept, including the window
+#define ROWS    24
+#define COLS    80
+
+static struct {
+  ushort line[NSCROLL][COLS];
+  uint top;     // number of the window's first line
+  uint view;    // number of the first line shown
+  uint shown;   // view as of the last cgasync()
+  uint dirty;   // window rows changed since then, a bit each
+} scr;
+
+// Cursor position in the window, col + 80*row, kept in memory
+// so that output does no port I/O per character.  -1 until it is
+// first needed, when the screen and cursor the BIOS left are taken
+// in as the first lines of the ring.
+static int cgapos = -1;
+
+static int
+cgacursor(void)
+{
+  int r;
+
+  if(cgapos < 0){
+    outb(CRTPORT, 14);
+    cgapos = inb(CRTPORT+1) << 8;
+    outb(CRTPORT, 15);
+    cgapos |= inb(CRTPORT+1);
+    for(r = 0; r < ROWS; r++)
+      memmove(scr.line[r], crt + r*COLS, sizeof(scr.line[r]));
+  }
+  return cgapos;
+}
+
+// Move the window down a line, clearing the line that comes into view.
 static void
-cgaputc(int c)
+scrollone(void)
 {
-  int pos;
-  
-  // Cursor position: col + 80*row.
+  scr.top++;
+  scr.view = scr.top;
+  cgapos -= COLS;
+  memset(scr.line[(scr.top + ROWS-1) % NSCROLL], 0, sizeof(scr.line[0]));
+  scr.dirty = (1 << ROWS) - 1;
+}
+
+// Return the ring cell at absolute position a, COLS*line + col,
+// which is about to be written, moving the window down to it.
+static ushort*
+cellat(uint a)
+{
+  while(a/COLS >= scr.top + ROWS)
+    scrollone();
+  scr.view = scr.top;
+  if(a/COLS >= scr.top)
+    scr.dirty |= 1 << (a/COLS - scr.top);
+  return &scr.line[(a/COLS) % NSCROLL][a%COLS];
+}
+
+// The cell at window position pos.
+static ushort*
+cell(int pos)
+{
+  return cellat(scr.top*COLS + pos);
+}
+
+static void
+cgasync(void)
+{
+  int r;
+
+  cgacursor();
+  if(scr.view != scr.shown){
+    scr.dirty = (1 << ROWS) - 1;
+    scr.shown = scr.view;
+  }
+  for(r = 0; scr.dirty; r++, scr.dirty >>= 1)
+    if(scr.dirty & 1)
+      memmove(crt + r*COLS, scr.line[(scr.view + r) % NSCROLL],
+              sizeof(scr.line[0]));
+  // Off the screen while looking back.
+  r = scr.view == scr.top ? cgapos : (ROWS+1)*COLS;
   outb(CRTPORT, 14);
-  pos = inb(CRTPORT+1) << 8;
+  outb(CRTPORT+1, r>>8);
   outb(CRTPORT, 15);
-  pos |= inb(CRTPORT+1);
+  outb(CRTPORT+1, r);
+}
+
+// Move the window down until the cursor is in it.
+static void
+cgascroll(void)
+{
+  while((cgapos/COLS) >= ROWS)
+    scrollone();
+}
+
+// Show lines n further down the ring (up if n < 0),
+// staying between the oldest line kept and the live window.
+static void
+cgaview(int n)
+{
+  uint lo;
+
+  cgacursor();
+  lo = scr.top + ROWS > NSCROLL ? scr.top + ROWS - NSCROLL : 0;
+  if(n < 0 && scr.view - lo < -n)
+    scr.view = lo;
+  else if(n > 0 && scr.top - scr.view < n)
+    scr.view = scr.top;
+  else
+    scr.view += n;
+  cgasync();
+}
 
+static void
+cgaputc(int c)
+{
+  cgacursor();
   if(c == '\n')
-    pos += 80 - pos%80;
+    cgapos += COLS - cgapos%COLS;
   else if(c == BACKSPACE){
-    if(pos > 0) --pos;
+    if(cgapos > 0) --cgapos;
   } else
-    crt[pos++] = (c&0xff) | 0x0700;  // black on white
-  
-  if((pos/80) >= 24){  // Scroll up.
-    memmove(crt, crt+80, sizeof(crt[0])*23*80);
-    pos -= 80;
-    memset(crt+pos, 0, sizeof(crt[0])*(24*80 - pos));
+    *cell(cgapos++) = (c&0xff) | 0x0700;  // black on white
+  cgascroll();
+  *cell(cgapos) = ' ' | 0x0700;
+}
+
+// Put n bytes on the screen, copying each run of characters
+// up to a newline or the end of a row straight into the ring.
+static void
+cgawrite(char *buf, int n)
+{
+  ushort *p;
+  int i, m;
+
+  cgacursor();
+  for(i = 0; i < n; ){
+    if(buf[i] == '\n'){
+      cgapos += COLS - cgapos%COLS;
+      i++;
+    } else {
+      p = cell(cgapos);
+      m = COLS - cgapos%COLS;
+      for(; m > 0 && i < n && buf[i] != '\n'; m--, i++)
+        *p++ = (buf[i]&0xff) | 0x0700;
+      cgapos += COLS - cgapos%COLS - m;
+    }
+    cgascroll();
   }
-  
-  outb(CRTPORT, 14);
-  outb(CRTPORT+1, pos>>8);
-  outb(CRTPORT, 15);
-  outb(CRTPORT+1, pos);
-  crt[pos] = ' ' | 0x0700;
+  *cell(cgapos) = ' ' | 0x0700;
 }
 
 void
@@ -204,138 +348,568 @@ consputc(int c)
   cgaputc(c);
 }
 
-int
-getcursor()
+// The line being typed, in a gap buffer: the text before the
+// cursor is buf[0..gs) and the text after it buf[ge..EDITBUF), so
+// typing and deleting at the cursor move no text.  The line is
+// shown starting at absolute screen position origin.  Edits note
+// the first character they change, and eddraw() rewrites the
+// screen from there on only.  The editor is guarded by input.lock;
+// edanchor() and eddraw() also need cons.lock, as for any change
+// to the screen.
+static struct {
+  char buf[EDITBUF];
+  int gs, ge;          // the gap
+  uint origin;         // where the line starts on the screen
+  int shown;           // characters of it on the screen
+  int chg;             // first character changed since drawn
+  uint cur;            // absolute cursor position after drawing
+  int over;            // overwrite mode, toggled by Ins
+  char kill[EDITBUF];  // text last killed, for ^Y
+  int nkill;
+} ed = { .ge = EDITBUF };
+
+static int
+edlen(void)
 {
-    int pos;
-    // Cursor position: col + 80*row.
-    outb(CRTPORT, 14);
-    pos = inb(CRTPORT+1) << 8;
-    outb(CRTPORT, 15);
-    pos |= inb(CRTPORT+1);
-    return pos;
+  return ed.gs + EDITBUF - ed.ge;
 }
 
-void
-setcursor(int pos)
+static int
+edat(int i)
 {
-    int old = getcursor();
-    if (pos == -1)
-        pos = old + 80 - old % 80;
-    else
-        input.e += pos - old;
+  return i < ed.gs ? ed.buf[i] : ed.buf[i + ed.ge - ed.gs];
+}
 
-    if((pos/80) >= 24){  // Scroll up.
-        memmove(crt, crt+80, sizeof(crt[0])*23*80);
-        pos -= 80;
-        memset(crt+pos, 0, sizeof(crt[0])*(24*80 - pos));
-    }   
-    outb(CRTPORT, 14);
-    outb(CRTPORT+1, pos>>8);
-    outb(CRTPORT, 15);
-    outb(CRTPORT+1, pos);
-}
-
-void 
-insertc(int c)
-{
-    int pos = getcursor();
-    int i, j;
-    if (c != 0 && input.l - input.r < INPUT_BUF){
-        for (i = input.l, j = pos + input.l - input.e; i > input.e; --i, --j){
-            input.buf[i] = input.buf[i - 1];
-            crt[j] = crt[j - 1] | WHITE_ON_BLACK;
-        }
-        input.buf[input.e % INPUT_BUF] = c;
-        input.l++;
-        
-        if (c == '\n'){
-            input.e++;
-            setcursor(-1);
-        }
-        else
-        {
-            crt[pos++] = (c & 0xff) | WHITE_ON_BLACK;
-            setcursor(pos);
-        }
+// Move the cursor to just before character i.
+static void
+edmove(int i)
+{
+  int n;
 
-    }
+  if(i < ed.gs){
+    n = ed.gs - i;
+    memmove(ed.buf + ed.ge - n, ed.buf + i, n);
+    ed.gs -= n;
+    ed.ge -= n;
+  } else if(i > ed.gs){
+    n = i - ed.gs;
+    memmove(ed.buf + ed.gs, ed.buf + ed.ge, n);
+    ed.gs += n;
+    ed.ge += n;
+  }
 }
 
-void
-replacec(int c)
+// Delete characters i..j-1, saving them for ^Y if save is set.
+static void
+eddelete(int i, int j, int save)
+{
+  int k;
+
+  if(i >= j)
+    return;
+  if(save){
+    for(k = i; k < j; k++)
+      ed.kill[k-i] = edat(k);
+    ed.nkill = j - i;
+  }
+  edmove(j);
+  ed.gs = i;
+  if(i < ed.chg)
+    ed.chg = i;
+}
+
+// Insert n characters at the cursor, replacing those after it
+// in overwrite mode.  What does not fit in EDITBUF-1 is dropped.
+static void
+edinsert(char *s, int n)
+{
+  if(ed.over)
+    eddelete(ed.gs, ed.gs + n < edlen() ? ed.gs + n : edlen(), 0);
+  if(n > EDITBUF-1 - edlen())
+    n = EDITBUF-1 - edlen();
+  if(n <= 0)
+    return;
+  if(ed.gs < ed.chg)
+    ed.chg = ed.gs;
+  memmove(ed.buf + ed.gs, s, n);
+  ed.gs += n;
+}
+
+// Replace the whole line with s.
+static void
+edset(char *s)
+{
+  ed.over = 0;
+  eddelete(0, edlen(), 0);
+  edinsert(s, strlen(s));
+}
+
+static int
+isspace(int c)
+{
+  return c == ' ' || c == '\t';
+}
+
+// Start of the word before the cursor.
+static int
+wordleft(void)
+{
+  int i;
+
+  for(i = ed.gs; i > 0 && isspace(edat(i-1)); i--)
+    ;
+  for(; i > 0 && !isspace(edat(i-1)); i--)
+    ;
+  return i;
+}
+
+// End of the word after the cursor.
+static int
+wordright(void)
+{
+  int i, n;
+
+  n = edlen();
+  for(i = ed.gs; i < n && isspace(edat(i)); i++)
+    ;
+  for(; i < n && !isspace(edat(i)); i++)
+    ;
+  return i;
+}
+
+// If something was written to the console since the line was
+// last drawn, start showing the line afresh at the cursor.
+static void
+edanchor(void)
+{
+  uint a;
+
+  a = scr.top*COLS + cgacursor();
+  if(a != ed.cur){
+    ed.origin = a;
+    ed.shown = ed.chg = 0;
+    ed.cur = a;
+  }
+}
+
+// Bring the screen up to date with the line: rewrite the
+// characters from the first changed one to the end of what is
+// or was shown, then put the cursor in place.
+static void
+eddraw(void)
+{
+  int i, n;
+
+  n = edlen();
+  for(i = ed.chg; i < n || i < ed.shown; i++)
+    *cellat(ed.origin + i) = (i < n ? edat(i) & 0xff : ' ') | WHITE_ON_BLACK;
+  ed.shown = ed.chg = n;
+  ed.cur = ed.origin + ed.gs;
+  cgapos = ed.cur - scr.top*COLS;
+}
+
+// Pass the line, followed by c ('\n', or nothing if c is 0), to
+// readers and start a new one.  Returns -1 if there is no room.
+static int
+edcommit(int c)
+{
+  int i, n;
+
+  n = edlen();
+  if(INPUT_BUF - (input.w - input.r) < n + 1)
+    return -1;
+  for(i = 0; i < n; i++)
+    input.buf[input.w++ % INPUT_BUF] = edat(i);
+  if(c)
+    input.buf[input.w++ % INPUT_BUF] = c;
+  wakeup(&input.r);
+
+  if(c == '\n'){
+    cgapos = ed.origin + n - scr.top*COLS;
+    cgapos += COLS - cgapos%COLS;
+    cgascroll();
+  }
+  ed.gs = ed.shown = ed.chg = ed.over = 0;
+  ed.ge = EDITBUF;
+  ed.cur = ed.origin = scr.top*COLS + cgapos;
+  return 0;
+}
+
+// The shell's command history for the current console session,
+// pushed by the shell one command at a time.  Command texts lie end
+// to end in a circular byte buffer, and adding a command drops the
+// oldest ones until it fits.
+//
+// Each command also has a signature for reverse search (^R): its
+// trigrams hashed into a 128-bit set.  A command can hold the query
+// only if its signature has every bit of the query's, so most are
+// turned away by a few word compares and only the rest are scanned
+// for the query text.
+//
+// The filter works for commands of ordinary length.  A command
+// with t trigrams sets about 1-e^(-t/128) of the bits: a fifth
+// for a 30-character command, so a 5-character query's three
+// trigrams all hit by chance under 1% of the time.  Past about 100
+// characters most bits are set and the command is nearly always
+// scanned.  Searching is bounded anyway by what is kept here:
+// at most NHIST commands and HISTBUF bytes, well under a
+// millisecond even if every byte is scanned.  That is far short of
+// the tens of thousands of commands the shell's log can hold; ^R
+// does not see older commands.
+#define NHIST    1024   // commands kept
+#define HISTBUF  32768  // bytes of command text kept
+#define SIGWORDS 4
+
+static struct {
+  char text[HISTBUF];
+  uint end;             // text bytes ever stored; next goes at end%HISTBUF
+  int first;            // commands first..n-1 are kept,
+  int n;                // command i in cmd[i%NHIST]
+  struct {
+    uint off;           // text[off%HISTBUF]
+    uint len;
+    uint sig[SIGWORDS];
+  } cmd[NHIST];
+  int cur;              // command shown by up/down; n if none
+} hist;
+
+static struct {
+  int on;             // ^R typed and not yet left
+  char q[EDITBUF];    // the query
+  int n;
+  int at;             // command shown as the match, or -1
+} search;
+
+static void
+sigof(char *s, uint *sig)
 {
-    int pos = getcursor();
-    input.buf[input.e] = c;
-    crt[pos] = c;
+  int i, h, n;
+
+  memset(sig, 0, SIGWORDS*sizeof(uint));
+  n = strlen(s);
+  for(i = 0; i+2 < n; i++){
+    h = (uchar)s[i]*31*31 + (uchar)s[i+1]*31 + (uchar)s[i+2];
+    h %= 32*SIGWORDS;
+    sig[h/32] |= 1 << (h%32);
+  }
+}
+
+// Copy command i into buf, which holds EDITBUF bytes.
+static void
+histget(int i, char *buf)
+{
+  uint j, off, len;
+
+  off = hist.cmd[i%NHIST].off;
+  len = hist.cmd[i%NHIST].len;
+  for(j = 0; j < len; j++)
+    buf[j] = hist.text[(off+j)%HISTBUF];
+  buf[len] = 0;
 }
 
-//Delete a character at pos
-//mode 0,backspace 1,delete
+// Add cmd as the newest command of the session,
+// or start a new, empty session if cmd is 0.
 void
-deletec(int mode)
-{
-    int pos = getcursor();
-    if (mode == 0){
-        if (input.e != input.w && pos > 0){
-            input.l--;
-            pos--;
-            setcursor(pos);
-        }
-        else
-            return ;
+consolehistadd(char *cmd)
+{
+  uint len;
+  int i;
+
+  acquire(&input.lock);
+  search.on = 0;
+  if(cmd == 0){
+    hist.first = hist.n = hist.cur = 0;
+    release(&input.lock);
+    return;
+  }
+  if((len = strlen(cmd)) > EDITBUF-1)
+    len = EDITBUF-1;
+  while(hist.first < hist.n && (hist.n - hist.first == NHIST ||
+        hist.end + len - hist.cmd[hist.first%NHIST].off > HISTBUF))
+    hist.first++;
+  i = hist.n % NHIST;
+  hist.cmd[i].off = hist.end;
+  hist.cmd[i].len = len;
+  for(; len > 0; len--, cmd++)
+    hist.text[hist.end++ % HISTBUF] = *cmd;
+  histget(hist.n, input.hbuf);
+  sigof(input.hbuf, hist.cmd[i].sig);
+  hist.cur = ++hist.n;
+  release(&input.lock);
+}
+
+static int
+contains(char *s, char *q, int n)
+{
+  for(; *s; s++)
+    if(strncmp(s, q, n) == 0)
+      return 1;
+  return n == 0;
+}
+
+// Return the newest command no newer than i
+// that contains the query, or -1 if there is none.
+static int
+histsearch(int i)
+{
+  uint qsig[SIGWORDS], *sig;
+  int j;
+
+  sigof(search.q, qsig);
+  for(; i >= hist.first; i--){
+    sig = hist.cmd[i%NHIST].sig;
+    for(j = 0; j < SIGWORDS; j++)
+      if((sig[j] & qsig[j]) != qsig[j])
+        break;
+    if(j < SIGWORDS)
+      continue;
+    histget(i, input.hbuf);
+    if(contains(input.hbuf, search.q, search.n))
+      return i;
+  }
+  return -1;
+}
+
+// Replace the edit line with command i, or clear it if i is hist.n.
+static void
+showhist(int i)
+{
+  hist.cur = i;
+  input.hbuf[0] = 0;
+  if(i < hist.n)
+    histget(i, input.hbuf);
+  edset(input.hbuf);
+}
+
+static void
+showmatch(int i)
+{
+  if(i < 0)
+    return;
+  search.at = i;
+  showhist(i);
+}
+
+// Handle key c in search mode.  Typing extends the query and
+// shows the newest match from the current one back; ^R steps to
+// the next older match.  Any other key leaves search mode, with
+// the match left on the line, and is then handled as usual.
+// Returns 1 if c was used up.
+static int
+searchkey(int c)
+{
+  switch(c){
+  case C('R'):
+    showmatch(histsearch((search.at < 0 ? hist.n : search.at) - 1));
+    return 1;
+  case C('H'): case '\x7f':
+    if(search.n > 0){
+      search.q[--search.n] = 0;
+      showmatch(histsearch(hist.n - 1));
     }
-    if (mode == 1){
-        if (input.e < input.l){
-            input.l--;
-        }
-        else
-            return ;
+    return 1;
+  }
+  if(c >= ' ' && c < 0x7f){
+    if(search.n < sizeof(search.q)-1){
+      search.q[search.n++] = c;
+      search.q[search.n] = 0;
+      showmatch(histsearch(search.at < 0 ? hist.n - 1 : search.at));
     }
+    return 1;
+  }
+  search.on = 0;
+  return 0;
+}
 
-    int i, j;
-    for (i = input.e, j = pos; i < input.l; ++i, ++j){
-        input.buf[i] = input.buf[i + 1];
-        crt[j] = crt[j + 1] | WHITE_ON_BLACK;
-    }
-    crt[j] = ' ' | WHITE_ON_BLACK;
+// Ask the shell to complete the word before the cursor, by
+// passing it the line up to the cursor ended by a NUL, which
+// cannot be typed.  The shell answers with complete().
+static void
+edrequest(void)
+{
+  int i;
+
+  if(INPUT_BUF - (input.w - input.r) < ed.gs + 1)
+    return;
+  for(i = 0; i < ed.gs; i++)
+    input.buf[input.w++ % INPUT_BUF] = ed.buf[i];
+  input.buf[input.w++ % INPUT_BUF] = 0;
+  wakeup(&input.r);
 }
 
+// Insert s, the shell's completion, at the cursor.
 void
-clearline()
-{
-    int i;
-    int pos = getcursor();
-    pos -= (input.e - input.w);
-    setcursor(pos);
-    for (i = pos; i < pos + input.l; ++i){
-        crt[i] = ' ' | WHITE_ON_BLACK;
-    }
-    input.l = input.w;
+consolecomplete(char *s)
+{
+  int over;
+
+  acquire(&input.lock);
+  acquire(&cons.lock);
+  edanchor();
+  over = ed.over;
+  ed.over = 0;
+  edinsert(s, strlen(s));
+  ed.over = over;
+  eddraw();
+  cgasync();
+  release(&cons.lock);
+  release(&input.lock);
 }
 
-void
-insertline(char* buf)
-{
-    int i, j, k;
-    int pos = getcursor();
-    input.l = input.w + strlen(buf);
-    for (i = input.w, j = pos, k = 0; i < input.l; ++i, ++j, ++k){
-        input.buf[i] = buf[k];
-        crt[j] = buf[k] | WHITE_ON_BLACK;
+// Turn the escape sequences that terminals on the serial port
+// send for the arrows, Home, End, Ins, Del, PgUp and PgDn into the
+// keyboard's codes for those keys, and ESC b and ESC f into word
+// motions.  Returns -1 while in the middle of a sequence.
+static int
+escseq(int c)
+{
+  static int state, arg;
+
+  switch(state){
+  case 1:  // after ESC
+    state = 0;
+    if(c == '['){
+      state = 2;
+      arg = 0;
+      return -1;
+    }
+    if(c == 'b')
+      return KEY_WLF;
+    if(c == 'f')
+      return KEY_WRT;
+    return c;
+  case 2:  // after ESC [
+    if(c >= '0' && c <= '9'){
+      arg = arg*10 + c - '0';
+      return -1;
     }
-    setcursor(pos + strlen(buf));
+    state = 0;
+    switch(c){
+    case 'A': return KEY_UP;
+    case 'B': return KEY_DN;
+    case 'C': return KEY_RT;
+    case 'D': return KEY_LF;
+    case 'H': return KEY_HOME;
+    case 'F': return KEY_END;
+    case '~':
+      switch(arg){
+      case 1: case 7: return KEY_HOME;
+      case 2: return KEY_INS;
+      case 3: return KEY_DEL;
+      case 4: case 8: return KEY_END;
+      case 5: return KEY_PGUP;
+      case 6: return KEY_PGDN;
+      }
+    }
+    return -1;
+  }
+  if(c == '\033'){
+    state = 1;
+    return -1;
+  }
+  return c;
 }
 
-void
-uartprint(int k)
+static void
+edkey(int c)
 {
-    if (k < 10)
-      uartputc(k + 48);
-    else{
-      uartprint(k / 10);
-      uartputc(k % 10 + 48);
+  switch(c){
+  case C('R'):  // reverse history search
+    search.on = 1;
+    search.n = 0;
+    search.q[0] = 0;
+    search.at = -1;
+    break;
+  case C('C'):  // interrupt foreground job, or a shell's builtins
+    if(fgpgrp){
+      if(fgself)
+        edset("");  // the shell will prompt for a new line
+      killpg(fgpgrp, SIGINT);
     }
+    break;
+  case C('Z'):  // stop foreground job, but never a shell
+    if(fgpgrp && !fgself)
+      killpg(fgpgrp, SIGTSTP);
+    break;
+  case C('A'): case KEY_HOME:
+    edmove(0);
+    break;
+  case C('E'): case KEY_END:
+    edmove(edlen());
+    break;
+  case C('B'): case KEY_LF:
+    if(ed.gs > 0)
+      edmove(ed.gs - 1);
+    break;
+  case C('F'): case KEY_RT:
+    if(ed.gs < edlen())
+      edmove(ed.gs + 1);
+    break;
+  case KEY_WLF:
+    edmove(wordleft());
+    break;
+  case KEY_WRT:
+    edmove(wordright());
+    break;
+  case C('H'): case '\x7f':  // Backspace
+    if(ed.gs > 0)
+      eddelete(ed.gs - 1, ed.gs, 0);
+    break;
+  case KEY_DEL:
+    if(ed.gs < edlen())
+      eddelete(ed.gs, ed.gs + 1, 0);
+    break;
+  case C('U'):  // Kill to start of line.
+    eddelete(0, ed.gs, 1);
+    break;
+  case C('K'):  // Kill to end of line.
+    eddelete(ed.gs, edlen(), 1);
+    break;
+  case C('W'):  // Kill word before cursor.
+    eddelete(wordleft(), ed.gs, 1);
+    break;
+  case C('Y'):  // Yank.
+    edinsert(ed.kill, ed.nkill);
+    break;
+  case KEY_INS:
+    ed.over = !ed.over;
+    break;
+  case KEY_PGUP:
+    cgaview(-ROWS/2);
+    break;
+  case KEY_PGDN:
+    cgaview(ROWS/2);
+    break;
+  case KEY_UP:
+    if(hist.cur > hist.first)
+      showhist(hist.cur - 1);
+    break;
+  case KEY_DN:
+    if(hist.cur < hist.n)
+      showhist(hist.cur + 1);
+    break;
+  case '\t':  // Complete at a shell's prompt; else, for a job, a tab.
+    if(fgpgrp && fgself)
+      edrequest();
+    else
+      edinsert("\t", 1);
+    break;
+  case '\r': case '\n':
+    edmove(edlen());
+    eddraw();
+    edcommit('\n');
+    break;
+  case C('D'):  // EOF if the line is empty, else pass it on as is
+    eddraw();
+    edcommit(edlen() == 0 ? C('D') : 0);
+    break;
+  default:
+    if(c >= ' ' && c < 0x100 && c != 0x7f){
+      input.hbuf[0] = c;
+      edinsert(input.hbuf, 1);
+    }
+    break;
+  }
 }
 
 void
@@ -344,99 +918,26 @@ consoleintr(int (*getc)(void))
   int c;
 
   acquire(&input.lock);
-  int pos = getcursor();/*
-  int i;
-    uartprint(input.e);
-  uartputc(';');
-  uartprint(pos);
-  uartputc(';');
-  for (i = input.w; i < input.l; ++i)
-    uartputc(input.buf[i]);
-  uartputc('\n');*/
+  // The editor draws in the scrollback ring and moves cgapos,
+  // which output on other CPUs changes under cons.lock too.
+  acquire(&cons.lock);
   while((c = getc()) >= 0){
-    switch(c){
-    case C('C'):  // kill current process
-      sendsignal(1);
-      break;
-    case C('P'):  // Process listing.
+    if((c = escseq(c)) < 0)
+      continue;
+    if(c == C('P')){  // Process listing, which takes cons.lock.
+      release(&cons.lock);
+      search.on = 0;
       procdump();
-      break;
-    case C('U'):  // Kill line.
-      while(input.e != input.w &&
-            input.buf[(input.e-1) % INPUT_BUF] != '\n'){
-        deletec(0);
-      }
-      break;
-    case C('H'): case '\x7f':  // Backspace
-      if(input.e != input.w){
-        deletec(0);
-      }
-      break;
-    case KEY_HOME: //Home
-        setcursor(pos - input.e);
-        break;
-    case KEY_END: // End
-        setcursor(pos + input.l - input.e);
-        break;
-    case KEY_PGUP:
-        break;
-    case KEY_PGDN:
-        break;
-    case KEY_INS:
-        break;
-    case KEY_DEL:
-        deletec(1);
-        break;
-    case KEY_LF: // Left
-        if (input.e != input.w){
-            setcursor(pos - 1);
-        }
-        break;
-    case KEY_RT: // Right
-        if (input.e < input.l){
-            setcursor(pos + 1);
-        }
-        break;
-    case KEY_UP:
-        if (hs.length != H_NUMBER && hs.curcmd == 0)
-            break;
-        if (hs.curcmd == (hs.lastcmd + 1) % H_NUMBER)
-            break;
-        uartputc('h');
-        clearline();
-        hs.curcmd = (hs.curcmd + H_NUMBER - 1) % H_NUMBER;
-        insertline(hs.record[hs.curcmd]);
-        break;
-
-    case KEY_DN:
-        if (hs.curcmd == hs.lastcmd)
-            break;
-        clearline();
-        hs.curcmd = (hs.curcmd + 1) % H_NUMBER;
-        insertline(hs.record[hs.curcmd]);
-        break;
-
-    default: //Insert
-      if(c != 0 && input.l-input.r < INPUT_BUF){
-        c = (c == '\r') ? '\n' : c;
-        
-        //Input enter
-        if(c == '\n' || c == C('D') || input.l == input.r + INPUT_BUF - 1){
-            //setcursor(-1);
-            //input.buf[input.l++ % INPUT_BUF] = '\n';
-            //input.e = input.l;
-            setcursor(pos + input.l - input.e);
-            insertc('\n');
-            input.w = input.l;
-            wakeup(&input.r);
-            break;
-        }
-        else
-            insertc(c);
-      }
-      break;
+      acquire(&cons.lock);
+      continue;
     }
+    edanchor();
+    if(!search.on || !searchkey(c))
+      edkey(c);
+    eddraw();
   }
+  cgasync();  // show edits the keys made
+  release(&cons.lock);
   release(&input.lock);
 }
 
@@ -450,8 +951,8 @@ consoleread(struct inode *ip, char *dst, int n)
   target = n;
   acquire(&input.lock);
   while(n > 0){
-    while(input.r == input.w){
-      if(proc->killed){
+    while(input.r == input.w || (fgpgrp && proc->pgid != fgpgrp)){
+      if(issig()){
         release(&input.lock);
         ilock(ip);
         return -1;
@@ -469,7 +970,8 @@ consoleread(struct inode *ip, char *dst, int n)
     }
     *dst++ = c;
     --n;
-    if(c == '\n')
+    // A line, a completion request, or what ^D passed on.
+    if(c == '\n' || c == 0 || input.r == input.w)
       break;
   }
   release(&input.lock);
@@ -478,6 +980,37 @@ consoleread(struct inode *ip, char *dst, int n)
   return target - n;
 }
 
+// Make pgid the foreground process group (none if 0).
+// Fails if there is no such group, or if the caller is neither
+// in the controlling group nor in the foreground.
+int
+consolesetpgrp(int pgid)
+{
+  int ctlalive;
+
+  if(pgid < 0 || (pgid != 0 && killpg(pgid, 0) < 0))
+    return -1;
+  ctlalive = ctlpgrp && killpg(ctlpgrp, 0) == 0;
+  acquire(&input.lock);
+  if(!ctlalive)
+    ctlpgrp = proc->pgid;
+  else if(proc->pgid != ctlpgrp && proc->pgid != fgpgrp){
+    release(&input.lock);
+    return -1;
+  }
+  fgpgrp = pgid;
+  fgself = pgid == proc->pgid;
+  wakeup(&input.r);
+  release(&input.lock);
+  return 0;
+}
+
+int
+consolegetpgrp(void)
+{
+  return fgpgrp;
+}
+
 int
 consolewrite(struct inode *ip, char *buf, int n)
 {
@@ -485,8 +1018,15 @@ consolewrite(struct inode *ip, char *buf, int n)
 
   iunlock(ip);
   acquire(&cons.lock);
+  if(panicked){
+    cli();
+    for(;;)
+      ;
+  }
   for(i = 0; i < n; i++)
-    consputc(buf[i] & 0xff);
+    uartputc(buf[i] & 0xff);
+  cgawrite(buf, n);
+  cgasync();
   release(&cons.lock);
   ilock(ip);
 
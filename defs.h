@@ -1,9 +1,13 @@
 struct buf;
 struct context;
 struct file;
+struct hashent;
 struct inode;
+struct kmem_cache;
 struct pipe;
 struct proc;
+struct rusage;
+struct sigaction;
 struct rtcdate;
 struct spinlock;
 struct stat;
@@ -19,10 +23,21 @@ void            bwrite(struct buf*);
 void            consoleinit(void);
 void            cprintf(char*, ...);
 void            consoleintr(int(*)(void));
+int             consolesetpgrp(int);
+int             consolegetpgrp(void);
+void            consolehistadd(char*);
+void            consolecomplete(char*);
 void            panic(char*) __attribute__((noreturn));
 
 // exec.c
-int             exec(char*, char**);
+int             exec(char*, char**, char**);
+
+// execpath.c
+void            execforget(char*);
+struct inode*   execlookup(char*, char*);
+void            execpathinit(void);
+int             hashstat(struct hashent*, int);
+void            rehash(void);
 
 // file.c
 struct file*    filealloc(void);
@@ -30,6 +45,7 @@ void            fileclose(struct file*);
 struct file*    filedup(struct file*);
 void            fileinit(void);
 int             fileread(struct file*, char*, int n);
+int             fileseek(struct file*, int, int);
 int             filestat(struct file*, struct stat*);
 int             filewrite(struct file*, char*, int n);
 
@@ -101,14 +117,15 @@ int             pipealloc(struct file**, struct file**);
 void            pipeclose(struct pipe*, int);
 int             piperead(struct pipe*, char*, int);
 int             pipewrite(struct pipe*, char*, int);
+void            pipeinit(void);
 
 //PAGEBREAK: 16
 // proc.c
 struct proc*    copyproc(struct proc*);
-void            exit(void);
+void            exit(int);
 int             fork(void);
 int             growproc(int);
-int             kill(int);
+int             kill(int, int);
 void            pinit(void);
 void            procdump(void);
 void            scheduler(void) __attribute__((noreturn));
@@ -116,13 +133,28 @@ void            sched(void);
 void            sleep(void*, struct spinlock*);
 void            userinit(void);
 int             wait(void);
+int             wait4(int, int*, int, struct rusage*);
 void            wakeup(void*);
 void            yield(void);
-void            sendsignal(int);
+int             killpg(int, int);
+int             setpgid(int, int);
+int             getpgid(int);
+void            checkstop(void);
+int             issig(void);
+int             nextsig(void);
+void            stopself(int);
+int             sigaction(int, struct sigaction*, struct sigaction*);
+int             sigprocmask(int, uint*, uint*);
+void            cpustat(uint*, uint*);
 
 // swtch.S
 void            swtch(struct context**, struct context*);
 
+// slab.c
+void            kmem_cache_init(struct kmem_cache*, char*, uint);
+void*           kmem_cache_alloc(struct kmem_cache*);
+void            kmem_cache_free(struct kmem_cache*, void*);
+
 // spinlock.c
 void            acquire(struct spinlock*);
 void            getcallerpcs(void*, uint*);
@@ -157,11 +189,13 @@ void            idtinit(void);
 extern uint     ticks;
 void            tvinit(void);
 extern struct spinlock tickslock;
+int             sigreturn(void);
 
 // uart.c
 void            uartinit(void);
 void            uartintr(void);
 void            uartputc(int);
+void            uartpanic(void);
 
 // vm.c
 void            seginit(void);
@@ -177,6 +211,7 @@ int             loaduvm(pde_t*, char*, struct inode*, uint, uint);
 pde_t*          copyuvm(pde_t*, uint);
 void            switchuvm(struct proc*);
 void            switchkvm(void);
+void            flushtlb(void);
 int             copyout(pde_t*, uint, void*, uint);
 void            clearpteu(pde_t *pgdir, char *uva);
 
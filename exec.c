@@ -2,68 +2,32 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "wait.h"
+#include "signal.h"
 #include "proc.h"
 #include "defs.h"
 #include "x86.h"
 #include "elf.h"
 
 int
-exec(char *path, char **argv)
+exec(char *path, char **argv, char **envp)
 {
   char *s, *last;
-  int i, off;
-  uint argc, sz, sp, ustack[3+MAXARG+1];
+  int i, n, off;
+  uint argc, envc, argsz, sz, sp, *ustack;
   struct elfhdr elf;
   struct inode *ip;
   struct proghdr ph;
   pde_t *pgdir, *oldpgdir;
 
-
-  char buf[1024];
-  struct inode *ippath;
-  if((ippath = namei("/path")) == 0){
-      end_op();
-      return(-1);
-  }
-  int n;
-  ilock(ippath);
-  if ((n = readi(ippath, buf, 0, sizeof(buf))) < 0){
-    return(-1);
-  }
-  iunlockput(ippath);
-  
-  int flag, p1 = 0, p2, p3, notend=1;
-  char pre[255];
-  flag = 1;
-  while (notend){
-    p2 = 0;
-    while(buf[p1] != 0 && buf[p1] != ';'){
-      pre[p2++] = buf[p1++];
-    }
-    if (buf[p1] == 0){
-      notend = 0;
-    }
-    p1++;
-    p3 = 0;
-    p2 = 1;
-    pre[0]='/';
-    while(path[p3]){
-      pre[p2++] = path[p3++];
-    }
-    pre[p2]=0;
-    begin_op();
-    if((ip = namei(pre)) != 0){
-      flag = 0;
-      break;
-    }
+  begin_op();
+  if((ip = execlookup(path, 0)) == 0){
     end_op();
-  }
-  if (flag){
     return -1;
   }
-
   ilock(ip);
   pgdir = 0;
+  ustack = 0;
 
   // Check ELF header
   if(readi(ip, (char*)&elf, 0, sizeof(elf)) < sizeof(elf))
@@ -92,32 +56,60 @@ exec(char *path, char **argv)
   end_op();
   ip = 0;
 
-  // Allocate two pages at the next page boundary.
-  // Make the first inaccessible.  Use the second as the user stack.
+  // Bytes of stack taken by the argument and environment
+  // strings and the pointers to them.
+  argsz = (4+2)*4;
+  for(argc = 0; argv[argc]; argc++){
+    if(argc >= MAXARG)
+      goto bad;
+    argsz += ((strlen(argv[argc]) + 1 + 3) & ~3) + 4;
+  }
+  for(envc = 0; envp && envp[envc]; envc++){
+    if(envc >= MAXARG)
+      goto bad;
+    argsz += ((strlen(envp[envc]) + 1 + 3) & ~3) + 4;
+  }
+  if(argsz > ARGMAX)
+    goto bad;
+
+  // Allocate a guard page at the next page boundary and make it
+  // inaccessible.  Above it goes the user stack: enough pages
+  // for the arguments, plus one.
   sz = PGROUNDUP(sz);
-  if((sz = allocuvm(pgdir, sz, sz + 2*PGSIZE)) == 0)
+  n = 1 + 1 + PGROUNDUP(argsz)/PGSIZE;
+  if((sz = allocuvm(pgdir, sz, sz + n*PGSIZE)) == 0)
     goto bad;
-  clearpteu(pgdir, (char*)(sz - 2*PGSIZE));
+  clearpteu(pgdir, (char*)(sz - n*PGSIZE));
   sp = sz;
 
-  // Push argument strings, prepare rest of stack in ustack.
+  // Push argument and environment strings, prepare rest of
+  // stack in ustack.  main is called as main(argc, argv, envp).
+  if((ustack = (uint*)kalloc()) == 0)
+    goto bad;
   for(argc = 0; argv[argc]; argc++) {
-    if(argc >= MAXARG)
-      goto bad;
     sp = (sp - (strlen(argv[argc]) + 1)) & ~3;
     if(copyout(pgdir, sp, argv[argc], strlen(argv[argc]) + 1) < 0)
       goto bad;
-    ustack[3+argc] = sp;
+    ustack[4+argc] = sp;
+  }
+  ustack[4+argc] = 0;
+  for(envc = 0; envp && envp[envc]; envc++) {
+    sp = (sp - (strlen(envp[envc]) + 1)) & ~3;
+    if(copyout(pgdir, sp, envp[envc], strlen(envp[envc]) + 1) < 0)
+      goto bad;
+    ustack[4+argc+1+envc] = sp;
   }
-  ustack[3+argc] = 0;
+  ustack[4+argc+1+envc] = 0;
 
   ustack[0] = 0xffffffff;  // fake return PC
   ustack[1] = argc;
-  ustack[2] = sp - (argc+1)*4;  // argv pointer
+  ustack[2] = sp - (argc+1+envc+1)*4;  // argv pointer
+  ustack[3] = ustack[2] + (argc+1)*4;  // envp pointer
 
-  sp -= (3+argc+1) * 4;
-  if(copyout(pgdir, sp, ustack, (3+argc+1)*4) < 0)
+  sp -= (4+argc+1+envc+1) * 4;
+  if(copyout(pgdir, sp, ustack, (4+argc+1+envc+1)*4) < 0)
     goto bad;
+  kfree((char*)ustack);
 
   // Save program name for debugging.
   for(last=s=path; *s; s++)
@@ -131,11 +123,17 @@ exec(char *path, char **argv)
   proc->sz = sz;
   proc->tf->eip = elf.entry;  // main
   proc->tf->esp = sp;
+  // Handlers were in the old image; ignored signals stay ignored.
+  for(i = 1; i < NSIG; i++)
+    if(proc->sigact[i].sa_handler != SIG_IGN)
+      proc->sigact[i].sa_handler = SIG_DFL;
   switchuvm(proc);
   freevm(oldpgdir);
   return 0;
 
  bad:
+  if(ustack)
+    kfree((char*)ustack);
   if(pgdir)
     freevm(pgdir);
   if(ip){
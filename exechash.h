@@ -0,0 +1,10 @@
+// Kernel cache of command lookups made by exec(), as
+// reported by hashstat().
+
+#define HASHPATH 64  // longest search directory plus name
+
+struct hashent {
+  char name[16];       // command name as given to exec
+  char path[HASHPATH]; // file it was found as, "" if not found
+  uint hits;           // lookups answered from the cache
+};
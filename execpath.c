@@ -0,0 +1,311 @@
+// Command lookup for exec.
+//
+// exec("ls") searches the directories listed in /path, which are
+// separated by ';' or white space.  The list is parsed once, and
+// parsed again only when /path is written (its inode's gen moves)
+// or a file named path is created or removed.
+//
+// The result of each search, including a failed one, is cached by
+// name together with a reference to the inode found, so repeated
+// execs of the same command do no path walks at all.  Creating or
+// removing a directory entry drops the cached entry with that name;
+// if the name is that of a search directory, or of /path, the whole
+// cache is dropped.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "spinlock.h"
+#include "fs.h"
+#include "file.h"
+#include "exechash.h"
+
+struct execent {
+  char name[DIRSIZ];
+  char path[HASHPATH];  // "" if not found
+  struct inode *ip;     // 0 if not found
+  uint hits;
+};
+
+struct {
+  struct spinlock lock;
+  int loaded;                   // dir[] is valid
+  struct inode *pathip;         // /path, if it exists
+  uint pathgen;                 // pathip->gen when dir[] was parsed
+  uint version;                 // bumped whenever the cache is dropped
+  int ndir;
+  char dir[NSEARCH][HASHPATH];  // search directories, absolute
+  struct execent ent[NEXECCACHE];
+  int hand;                     // next entry to replace
+} ecache;
+
+void
+execpathinit(void)
+{
+  initlock(&ecache.lock, "execpath");
+}
+
+// Drop all cached lookups, and the parsed search path as well
+// if path is set.  Inode references to be released are added
+// to put, which must have room for NEXECCACHE+1 entries.
+// Caller must hold ecache.lock.
+static int
+dropall(int path, struct inode **put)
+{
+  struct execent *e;
+  int n;
+
+  n = 0;
+  for(e = ecache.ent; e < &ecache.ent[NEXECCACHE]; e++){
+    if(e->ip)
+      put[n++] = e->ip;
+    memset(e, 0, sizeof(*e));
+  }
+  if(path){
+    if(ecache.pathip)
+      put[n++] = ecache.pathip;
+    ecache.pathip = 0;
+    ecache.loaded = 0;
+  }
+  ecache.version++;
+  return n;
+}
+
+// iput() can sleep, so it is called after ecache.lock is released.
+// Caller must be in a transaction.
+static void
+putall(struct inode **put, int n)
+{
+  while(n > 0)
+    iput(put[--n]);
+}
+
+// Last element of path.
+static char*
+lastelem(char *path)
+{
+  char *s, *last;
+
+  last = path;
+  for(s = path; *s; s++)
+    if(*s == '/' && s[1])
+      last = s+1;
+  return last;
+}
+
+// Parse /path again if it has changed.
+// Caller must be in a transaction.
+static void
+loadpath(void)
+{
+  struct inode *ip, *put[NEXECCACHE+1];
+  char buf[NSEARCH*HASHPATH], dir[NSEARCH][HASHPATH];
+  int i, n, ndir;
+  uint gen;
+
+  acquire(&ecache.lock);
+  ip = ecache.pathip;
+  if(ecache.loaded && (ip == 0 || ip->gen == ecache.pathgen)){
+    release(&ecache.lock);
+    return;
+  }
+  if(ip)
+    idup(ip);
+  release(&ecache.lock);
+
+  if(ip == 0)
+    ip = namei("/path");
+  n = 0;
+  gen = 0;
+  if(ip){
+    ilock(ip);
+    gen = ip->gen;
+    if((n = readi(ip, buf, 0, sizeof(buf)-1)) < 0)
+      n = 0;
+    iunlock(ip);
+  }
+  buf[n] = 0;
+
+  ndir = 0;
+  for(i = 0; buf[i] && ndir < NSEARCH; ){
+    while(buf[i] == ';' || buf[i] == ' ' || buf[i] == '\t' ||
+          buf[i] == '\r' || buf[i] == '\n')
+      i++;
+    if(buf[i] == 0)
+      break;
+    // Directories are taken relative to the root.
+    n = 0;
+    if(buf[i] != '/')
+      dir[ndir][n++] = '/';
+    for(; buf[i] && buf[i] != ';' && buf[i] != ' ' && buf[i] != '\t' &&
+          buf[i] != '\r' && buf[i] != '\n'; i++)
+      if(n < HASHPATH-DIRSIZ-2)
+        dir[ndir][n++] = buf[i];
+    while(n > 1 && dir[ndir][n-1] == '/')
+      n--;
+    dir[ndir++][n] = 0;
+  }
+  if(ndir == 0){
+    safestrcpy(dir[0], "/", HASHPATH);
+    ndir = 1;
+  }
+
+  acquire(&ecache.lock);
+  n = dropall(1, put);
+  ecache.pathip = ip;
+  ecache.pathgen = gen;
+  ecache.ndir = ndir;
+  memmove(ecache.dir, dir, sizeof(dir));
+  ecache.loaded = 1;
+  release(&ecache.lock);
+  putall(put, n);
+}
+
+static struct execent*
+findent(char *name)
+{
+  struct execent *e;
+
+  for(e = ecache.ent; e < &ecache.ent[NEXECCACHE]; e++)
+    if(e->name[0] && namecmp(e->name, name) == 0)
+      return e;
+  return 0;
+}
+
+// Return the inode that exec should run for path, referenced but
+// not locked, or 0 if there is none.  A path containing '/' is
+// used as is; any other name is searched for in /path's
+// directories.  If found is not 0, the file's path is copied there.
+// Caller must be in a transaction.
+struct inode*
+execlookup(char *path, char *found)
+{
+  struct execent *e;
+  struct inode *ip, *old;
+  char buf[HASHPATH];
+  uint version;
+  int i, n;
+
+  for(n = 0; path[n]; n++)
+    if(path[n] == '/')
+      break;
+  if(path[n] == '/' || n > DIRSIZ){
+    if(found)
+      safestrcpy(found, path, HASHPATH);
+    return namei(path);
+  }
+
+  loadpath();
+  acquire(&ecache.lock);
+  if((e = findent(path)) != 0){
+    e->hits++;
+    ip = e->ip ? idup(e->ip) : 0;
+    if(found)
+      safestrcpy(found, e->path, HASHPATH);
+    release(&ecache.lock);
+    return ip;
+  }
+  version = ecache.version;
+
+  ip = 0;
+  buf[0] = 0;
+  for(i = 0; ; i++){
+    if(i >= ecache.ndir){
+      buf[0] = 0;
+      break;
+    }
+    safestrcpy(buf, ecache.dir[i], HASHPATH);
+    release(&ecache.lock);
+    n = strlen(buf);
+    if(buf[n-1] != '/')
+      buf[n++] = '/';
+    safestrcpy(buf+n, path, HASHPATH-n);
+    ip = namei(buf);
+    acquire(&ecache.lock);
+    if(ip)
+      break;
+  }
+
+  // Remember the result, unless the cache was dropped meanwhile.
+  old = 0;
+  if(ecache.version == version && findent(path) == 0){
+    e = &ecache.ent[ecache.hand];
+    ecache.hand = (ecache.hand + 1) % NEXECCACHE;
+    old = e->ip;
+    strncpy(e->name, path, DIRSIZ);
+    safestrcpy(e->path, buf, HASHPATH);
+    e->ip = ip ? idup(ip) : 0;
+    e->hits = 0;
+  }
+  release(&ecache.lock);
+  if(old)
+    iput(old);
+  if(found)
+    safestrcpy(found, buf, HASHPATH);
+  return ip;
+}
+
+// A directory entry called name has been created or removed.
+// Caller must be in a transaction.
+void
+execforget(char *name)
+{
+  struct inode *put[NEXECCACHE+1];
+  struct execent *e;
+  int i, n;
+
+  n = 0;
+  acquire(&ecache.lock);
+  if(namecmp(name, "path") == 0){
+    n = dropall(1, put);
+  } else {
+    for(i = 0; i < ecache.ndir; i++)
+      if(namecmp(lastelem(ecache.dir[i]), name) == 0)
+        break;
+    if(i < ecache.ndir)
+      n = dropall(0, put);
+    else if((e = findent(name)) != 0){
+      if(e->ip)
+        put[n++] = e->ip;
+      memset(e, 0, sizeof(*e));
+    }
+  }
+  release(&ecache.lock);
+  putall(put, n);
+}
+
+// Drop the whole cache, including the parsed /path.
+// Caller must be in a transaction.
+void
+rehash(void)
+{
+  struct inode *put[NEXECCACHE+1];
+  int n;
+
+  acquire(&ecache.lock);
+  n = dropall(1, put);
+  release(&ecache.lock);
+  putall(put, n);
+}
+
+// Copy up to max cache entries to h; return how many.
+int
+hashstat(struct hashent *h, int max)
+{
+  struct execent *e;
+  int n;
+
+  n = 0;
+  acquire(&ecache.lock);
+  for(e = ecache.ent; e < &ecache.ent[NEXECCACHE] && n < max; e++){
+    if(e->name[0] == 0)
+      continue;
+    memset(&h[n], 0, sizeof(h[n]));
+    safestrcpy(h[n].name, e->name, DIRSIZ+1);
+    safestrcpy(h[n].path, e->path, HASHPATH);
+    h[n].hits = e->hits;
+    n++;
+  }
+  release(&ecache.lock);
+  return n;
+}
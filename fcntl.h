@@ -4,3 +4,7 @@
 #define O_CREATE  0x200
 #define O_ADD     0X010
 #define O_OVER    0X020
+
+#define SEEK_SET  0  // lseek whence values
+#define SEEK_CUR  1
+#define SEEK_END  2
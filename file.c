@@ -7,18 +7,21 @@
 #include "param.h"
 #include "fs.h"
 #include "file.h"
+#include "fcntl.h"
 #include "spinlock.h"
+#include "slab.h"
 
 struct devsw devsw[NDEV];
 struct {
-  struct spinlock lock;
-  struct file file[NFILE];
+  struct spinlock lock;     // protects ref in every file
+  struct kmem_cache cache;  // file structures come from here
 } ftable;
 
 void
 fileinit(void)
 {
   initlock(&ftable.lock, "ftable");
+  kmem_cache_init(&ftable.cache, "file", sizeof(struct file));
 }
 
 // Allocate a file structure.
@@ -27,16 +30,10 @@ filealloc(void)
 {
   struct file *f;
 
-  acquire(&ftable.lock);
-  for(f = ftable.file; f < ftable.file + NFILE; f++){
-    if(f->ref == 0){
-      f->ref = 1;
-      release(&ftable.lock);
-      return f;
-    }
-  }
-  release(&ftable.lock);
-  return 0;
+  if((f = kmem_cache_alloc(&ftable.cache)) == 0)
+    return 0;
+  f->ref = 1;
+  return f;
 }
 
 // Increment ref count for file f.
@@ -68,6 +65,7 @@ fileclose(struct file *f)
   f->ref = 0;
   f->type = FD_NONE;
   release(&ftable.lock);
+  kmem_cache_free(&ftable.cache, f);
   
   if(ff.type == FD_PIPE)
     pipeclose(ff.pipe, ff.writable);
@@ -111,6 +109,34 @@ fileread(struct file *f, char *addr, int n)
   panic("fileread");
 }
 
+// Move the offset of file f to off, counted from the start,
+// the current offset or the end as whence is SEEK_SET, SEEK_CUR
+// or SEEK_END.  Returns the new offset.
+int
+fileseek(struct file *f, int off, int whence)
+{
+  if(f->type != FD_INODE)
+    return -1;
+  switch(whence){
+  case SEEK_SET:
+    break;
+  case SEEK_CUR:
+    off += f->off;
+    break;
+  case SEEK_END:
+    ilock(f->ip);
+    off += f->ip->size;
+    iunlock(f->ip);
+    break;
+  default:
+    return -1;
+  }
+  if(off < 0)
+    return -1;
+  f->off = off;
+  return off;
+}
+
 //PAGEBREAK!
 // Write to file f.
 int
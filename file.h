@@ -15,6 +15,7 @@ struct inode {
   uint inum;          // Inode number
   int ref;            // Reference count
   int flags;          // I_BUSY, I_VALID
+  uint gen;           // new value on every load and data write
 
   short type;         // copy of disk inode
   short major;
@@ -22,6 +23,9 @@ struct inode {
   short nlink;
   uint size;
   uint addrs[NDIRECT+1];
+  struct inode *next; // icache hash chain
+  struct inode *uprev; // icache unused list, while ref == 0
+  struct inode *unext;
 };
 #define I_BUSY 0x1
 #define I_VALID 0x2
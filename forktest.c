@@ -1,5 +1,6 @@
 // Test that fork fails gracefully.
-// Tiny executable so that the limit can be filling the proc table.
+// Tiny executable so that the limit is reached quickly.
+// N must be more than NPROC.
 
 #include "types.h"
 #include "stat.h"
@@ -25,24 +26,24 @@ forktest(void)
     if(pid < 0)
       break;
     if(pid == 0)
-      exit();
+      exit(0);
   }
   
   if(n == N){
     printf(1, "fork claimed to work N times!\n", N);
-    exit();
+    exit(1);
   }
   
   for(; n > 0; n--){
     if(wait() < 0){
       printf(1, "wait stopped early\n");
-      exit();
+      exit(1);
     }
   }
   
   if(wait() != -1){
     printf(1, "wait got too many\n");
-    exit();
+    exit(1);
   }
   
   printf(1, "fork test OK\n");
@@ -52,5 +53,5 @@ int
 main(void)
 {
   forktest();
-  exit();
+  exit(0);
 }
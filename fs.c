@@ -14,8 +14,11 @@
 #include "param.h"
 #include "stat.h"
 #include "mmu.h"
+#include "wait.h"
+#include "signal.h"
 #include "proc.h"
 #include "spinlock.h"
+#include "slab.h"
 #include "buf.h"
 #include "fs.h"
 #include "file.h"
@@ -156,15 +159,57 @@ bfree(int dev, uint b)
 // have locked the inodes involved; this lets callers create
 // multi-step atomic operations.
 
+// The cache holds the inodes with ip->ref > 0, on hash chains
+// keyed by inode number, and up to NIUNUSED more whose last
+// reference has gone, on the unused list, so that a file looked
+// up again soon (a directory being listed, /path) is not read
+// again and keeps its generation.  iput() hands the least
+// recently used of those back to the slab cache.
+
+#define NIHASH 61
+
 struct {
   struct spinlock lock;
-  struct inode inode[NINODE];
+  struct kmem_cache cache;
+  struct inode *hash[NIHASH];
+  uint gen;                  // last inode generation handed out
+
+  // Inodes with ref == 0, through uprev/unext.
+  // unused.unext is most recently used.
+  struct inode unused;
+  int nunused;
 } icache;
 
+// Return a generation number that no inode has had before,
+// so that ip->gen never repeats a value even across eviction.
+static uint
+newgen(void)
+{
+  uint gen;
+
+  acquire(&icache.lock);
+  gen = ++icache.gen;
+  release(&icache.lock);
+  return gen;
+}
+
 void
 iinit(void)
 {
   initlock(&icache.lock, "icache");
+  kmem_cache_init(&icache.cache, "inode", sizeof(struct inode));
+  icache.unused.uprev = &icache.unused;
+  icache.unused.unext = &icache.unused;
+}
+
+// Take ip off the unused list.
+// Caller must hold icache.lock.
+static void
+iunused_remove(struct inode *ip)
+{
+  ip->uprev->unext = ip->unext;
+  ip->unext->uprev = ip->uprev;
+  icache.nunused--;
 }
 
 static struct inode* iget(uint dev, uint inum);
@@ -222,31 +267,30 @@ iupdate(struct inode *ip)
 static struct inode*
 iget(uint dev, uint inum)
 {
-  struct inode *ip, *empty;
+  struct inode *ip, **hp;
 
   acquire(&icache.lock);
 
   // Is the inode already cached?
-  empty = 0;
-  for(ip = &icache.inode[0]; ip < &icache.inode[NINODE]; ip++){
-    if(ip->ref > 0 && ip->dev == dev && ip->inum == inum){
-      ip->ref++;
+  hp = &icache.hash[inum % NIHASH];
+  for(ip = *hp; ip; ip = ip->next){
+    if(ip->dev == dev && ip->inum == inum){
+      if(ip->ref++ == 0)
+        iunused_remove(ip);
       release(&icache.lock);
       return ip;
     }
-    if(empty == 0 && ip->ref == 0)    // Remember empty slot.
-      empty = ip;
   }
 
-  // Recycle an inode cache entry.
-  if(empty == 0)
+  // Allocate a new inode cache entry.
+  if((ip = kmem_cache_alloc(&icache.cache)) == 0)
     panic("iget: no inodes");
-
-  ip = empty;
   ip->dev = dev;
   ip->inum = inum;
   ip->ref = 1;
   ip->flags = 0;
+  ip->next = *hp;
+  *hp = ip;
   release(&icache.lock);
 
   return ip;
@@ -290,6 +334,7 @@ ilock(struct inode *ip)
     ip->size = dip->size;
     memmove(ip->addrs, dip->addrs, sizeof(ip->addrs));
     brelse(bp);
+    ip->gen = newgen();
     ip->flags |= I_VALID;
     if(ip->type == 0)
       panic("ilock: no type");
@@ -310,8 +355,8 @@ iunlock(struct inode *ip)
 }
 
 // Drop a reference to an in-memory inode.
-// If that was the last reference, the inode cache entry can
-// be recycled.
+// If that was the last reference, the inode cache entry goes
+// on the unused list, and the oldest entry there is freed.
 // If that was the last reference and the inode has no links
 // to it, free the inode (and its content) on disk.
 // All calls to iput() must be inside a transaction in
@@ -319,6 +364,8 @@ iunlock(struct inode *ip)
 void
 iput(struct inode *ip)
 {
+  struct inode **pp;
+
   acquire(&icache.lock);
   if(ip->ref == 1 && (ip->flags & I_VALID) && ip->nlink == 0){
     // inode has no links and no other references: truncate and free.
@@ -333,7 +380,24 @@ iput(struct inode *ip)
     ip->flags = 0;
     wakeup(ip);
   }
-  ip->ref--;
+  if(--ip->ref == 0){
+    if(ip->flags & I_VALID){
+      ip->unext = icache.unused.unext;
+      ip->uprev = &icache.unused;
+      icache.unused.unext->uprev = ip;
+      icache.unused.unext = ip;
+      if(++icache.nunused <= NIUNUSED){
+        release(&icache.lock);
+        return;
+      }
+      ip = icache.unused.uprev;
+      iunused_remove(ip);
+    }
+    for(pp = &icache.hash[ip->inum % NIHASH]; *pp != ip; pp = &(*pp)->next)
+      ;
+    *pp = ip->next;
+    kmem_cache_free(&icache.cache, ip);
+  }
   release(&icache.lock);
 }
 
@@ -429,6 +493,7 @@ stati(struct inode *ip, struct stat *st)
   st->type = ip->type;
   st->nlink = ip->nlink;
   st->size = ip->size;
+  st->gen = ip->gen;
 }
 
 //PAGEBREAK!
@@ -478,6 +543,7 @@ writei(struct inode *ip, char *src, uint off, uint n)
   if(off + n > MAXFILE*BSIZE)
     return -1;
 
+  ip->gen = newgen();
   for(tot=0; tot<n; tot+=m, off+=m, src+=m){
     bp = bread(ip->dev, bmap(ip, off/BSIZE));
     m = min(n - tot, BSIZE - off%BSIZE);
@@ -556,6 +622,7 @@ dirlink(struct inode *dp, char *name, uint inum)
   de.inum = inum;
   if(writei(dp, (char*)&de, off, sizeof(de)) != sizeof(de))
     panic("dirlink");
+  execforget(name);
   
   return 0;
 }
@@ -5,6 +5,8 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "wait.h"
+#include "signal.h"
 #include "proc.h"
 #include "x86.h"
 #include "traps.h"
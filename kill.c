@@ -1,17 +1,28 @@
 #include "types.h"
 #include "stat.h"
 #include "user.h"
+#include "signal.h"
 
 int
 main(int argc, char **argv)
 {
-  int i;
+  int i, sig;
 
-  if(argc < 1){
-    printf(2, "usage: kill pid...\n");
-    exit();
+  if(argc < 2){
+    printf(2, "usage: kill [-sig] pid...\n");
+    exit(1);
   }
-  for(i=1; i<argc; i++)
-    kill(atoi(argv[i]));
-  exit();
+  sig = SIGTERM;
+  i = 1;
+  if(argv[1][0] == '-'){
+    sig = atoi(argv[1] + 1);
+    i++;
+  }
+  for(; i<argc; i++){
+    if(kill(atoi(argv[i]), sig) < 0){
+      printf(2, "kill: %s failed\n", argv[i]);
+      exit(1);
+    }
+  }
+  exit(0);
 }
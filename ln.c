@@ -7,9 +7,11 @@ main(int argc, char *argv[])
 {
   if(argc != 3){
     printf(2, "Usage: ln old new\n");
-    exit();
+    exit(1);
   }
-  if(link(argv[1], argv[2]) < 0)
+  if(link(argv[1], argv[2]) < 0){
     printf(2, "link %s %s: failed\n", argv[1], argv[2]);
-  exit();
+    exit(1);
+  }
+  exit(0);
 }
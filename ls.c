@@ -75,11 +75,13 @@ main(int argc, char *argv[])
 {
   int i;
 
+  // Fill whole buffers rather than writing a line at a time.
+  setvbuf(stdout, IOFBF);
   if(argc < 2){
     ls(".");
-    exit();
+    exit(0);
   }
   for(i=1; i<argc; i++)
     ls(argv[i]);
-  exit();
+  exit(0);
 }
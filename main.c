@@ -3,6 +3,8 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "wait.h"
+#include "signal.h"
 #include "proc.h"
 #include "x86.h"
 
@@ -31,7 +33,9 @@ main(void)
   tvinit();        // trap vectors
   binit();         // buffer cache
   fileinit();      // file table
+  pipeinit();      // pipe cache
   iinit();         // inode cache
+  execpathinit();  // command lookup cache
   ideinit();       // disk
   if(!ismp)
     timerinit();   // uniprocessor timer
@@ -46,7 +50,7 @@ main(void)
 static void
 mpenter(void)
 {
-  switchkvm(); 
+  lcr3(v2p(kpgdir));  // cpu is not set up yet, so not switchkvm()
   seginit();
   lapicinit();
   mpmain();
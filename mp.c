@@ -9,6 +9,8 @@
 #include "mp.h"
 #include "x86.h"
 #include "mmu.h"
+#include "wait.h"
+#include "signal.h"
 #include "proc.h"
 
 struct cpu cpus[NCPU];
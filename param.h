@@ -1,12 +1,14 @@
-#define NPROC        64  // maximum number of processes
+#define NPROC       256  // maximum number of processes
 #define KSTACKSIZE 4096  // size of per-process kernel stack
 #define NCPU          8  // maximum number of CPUs
 #define NOFILE       16  // open files per process
-#define NFILE       100  // open files per system
-#define NINODE       50  // maximum number of active i-nodes
 #define NDEV         10  // maximum major device number
 #define ROOTDEV       1  // device number of file system root disk
-#define MAXARG       32  // max exec arguments
+#define MAXARG      256  // max exec arguments, and environment strings
+#define ARGMAX    32768  // max bytes of exec arguments and environment
+#define NSEARCH       8  // directories in /path searched by exec
+#define NEXECCACHE   32  // command lookups cached by exec
+#define NIUNUSED     64  // unreferenced inodes kept in the inode cache
 #define MAXOPBLOCKS  10  // max # of blocks any FS op writes
 #define LOGSIZE      (MAXOPBLOCKS*3)  // max data sectors in on-disk log
 #define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
@@ -2,10 +2,13 @@
 #include "defs.h"
 #include "param.h"
 #include "mmu.h"
+#include "wait.h"
+#include "signal.h"
 #include "proc.h"
 #include "fs.h"
 #include "file.h"
 #include "spinlock.h"
+#include "slab.h"
 
 #define PIPESIZE 512
 
@@ -18,6 +21,14 @@ struct pipe {
   int writeopen;  // write fd is still open
 };
 
+static struct kmem_cache pipecache;
+
+void
+pipeinit(void)
+{
+  kmem_cache_init(&pipecache, "pipe", sizeof(struct pipe));
+}
+
 int
 pipealloc(struct file **f0, struct file **f1)
 {
@@ -27,7 +38,7 @@ pipealloc(struct file **f0, struct file **f1)
   *f0 = *f1 = 0;
   if((*f0 = filealloc()) == 0 || (*f1 = filealloc()) == 0)
     goto bad;
-  if((p = (struct pipe*)kalloc()) == 0)
+  if((p = kmem_cache_alloc(&pipecache)) == 0)
     goto bad;
   p->readopen = 1;
   p->writeopen = 1;
@@ -47,7 +58,7 @@ pipealloc(struct file **f0, struct file **f1)
 //PAGEBREAK: 20
  bad:
   if(p)
-    kfree((char*)p);
+    kmem_cache_free(&pipecache, p);
   if(*f0)
     fileclose(*f0);
   if(*f1)
@@ -68,7 +79,7 @@ pipeclose(struct pipe *p, int writable)
   }
   if(p->readopen == 0 && p->writeopen == 0){
     release(&p->lock);
-    kfree((char*)p);
+    kmem_cache_free(&pipecache, p);
   } else
     release(&p->lock);
 }
@@ -81,8 +92,14 @@ pipewrite(struct pipe *p, char *addr, int n)
 
   acquire(&p->lock);
   for(i = 0; i < n; i++){
-    while(p->nwrite == p->nread + PIPESIZE){  //DOC: pipewrite-full
-      if(p->readopen == 0 || proc->killed){
+    while(p->readopen == 0 || p->nwrite == p->nread + PIPESIZE){  //DOC: pipewrite-full
+      if(p->readopen == 0){
+        // Nobody will ever read it.
+        release(&p->lock);
+        kill(proc->pid, SIGPIPE);
+        return -1;
+      }
+      if(issig()){
         release(&p->lock);
         return -1;
       }
@@ -103,7 +120,7 @@ piperead(struct pipe *p, char *addr, int n)
 
   acquire(&p->lock);
   while(p->nread == p->nwrite && p->writeopen){  //DOC: pipe-empty
-    if(proc->killed){
+    if(issig()){
       release(&p->lock);
       return -1;
     }
@@ -3,13 +3,7 @@
 #include "user.h"
 
 static void
-putc(int fd, char c)
-{
-  write(fd, &c, 1);
-}
-
-static void
-printint(int fd, int xx, int base, int sgn)
+printint(FILE *f, int xx, int base, int sgn)
 {
   static char digits[] = "0123456789ABCDEF";
   char buf[16];
@@ -32,33 +26,31 @@ printint(int fd, int xx, int base, int sgn)
     buf[i++] = '-';
 
   while(--i >= 0)
-    putc(fd, buf[i]);
+    fbput(f, buf[i]);
 }
 
-// Print to the given fd. Only understands %d, %x, %p, %s.
-void
-printf(int fd, char *fmt, ...)
+// Only understands %d, %x, %p, %s.
+static void
+vprintf(FILE *f, char *fmt, uint *ap)
 {
   char *s;
   int c, i, state;
-  uint *ap;
 
   state = 0;
-  ap = (uint*)(void*)&fmt + 1;
   for(i = 0; fmt[i]; i++){
     c = fmt[i] & 0xff;
     if(state == 0){
       if(c == '%'){
         state = '%';
       } else {
-        putc(fd, c);
+        fbput(f, c);
       }
     } else if(state == '%'){
       if(c == 'd'){
-        printint(fd, *ap, 10, 1);
+        printint(f, *ap, 10, 1);
         ap++;
       } else if(c == 'x' || c == 'p'){
-        printint(fd, *ap, 16, 0);
+        printint(f, *ap, 16, 0);
         ap++;
       } else if(c == 's'){
         s = (char*)*ap;
@@ -66,20 +58,44 @@ printf(int fd, char *fmt, ...)
         if(s == 0)
           s = "(null)";
         while(*s != 0){
-          putc(fd, *s);
+          fbput(f, *s);
           s++;
         }
       } else if(c == 'c'){
-        putc(fd, *ap);
+        fbput(f, *ap);
         ap++;
       } else if(c == '%'){
-        putc(fd, c);
+        fbput(f, c);
       } else {
         // Unknown % sequence.  Print it to draw attention.
-        putc(fd, '%');
-        putc(fd, c);
+        fbput(f, '%');
+        fbput(f, c);
       }
       state = 0;
     }
   }
+  fdone(f);
+}
+
+void
+fprintf(FILE *f, char *fmt, ...)
+{
+  vprintf(f, fmt, (uint*)(void*)&fmt + 1);
+}
+
+// Print to the given fd: through stdout or stderr for 1 and 2,
+// and otherwise in as few writes as the text takes buffers.
+void
+printf(int fd, char *fmt, ...)
+{
+  FILE f;
+
+  if(fd == 1 || fd == 2){
+    vprintf(fd == 1 ? stdout : stderr, fmt, (uint*)(void*)&fmt + 1);
+    return;
+  }
+  memset(&f, 0, sizeof(f));
+  f.fd = fd;
+  f.mode = IONBF;
+  vprintf(&f, fmt, (uint*)(void*)&fmt + 1);
 }
@@ -4,12 +4,26 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "x86.h"
+#include "wait.h"
+#include "signal.h"
 #include "proc.h"
 #include "spinlock.h"
+#include "slab.h"
+
+// Processes are allocated from a slab cache and linked on
+// ptable.list, newest first, from allocproc() until wait()
+// reaps them.  Each is also on a hash chain by pid and on its
+// parent's list of children, so that finding a process by pid,
+// waiting for a child and reparenting cost time proportional
+// to the processes involved, not to the whole table.
+#define NPIDHASH 64
 
 struct {
   struct spinlock lock;
-  struct proc proc[NPROC];
+  struct kmem_cache cache;
+  struct proc *list;
+  int nproc;      // length of list
+  struct proc *pidhash[NPIDHASH];
 } ptable;
 
 static struct proc *initproc;
@@ -19,41 +33,57 @@ extern void forkret(void);
 extern void trapret(void);
 
 static void wakeup1(void *chan);
+static void freeproc(struct proc *p);
+static struct proc *findproc(int pid);
+static void psignal(struct proc *p, int sig);
 
 void
 pinit(void)
 {
   initlock(&ptable.lock, "ptable");
+  kmem_cache_init(&ptable.cache, "proc", sizeof(struct proc));
 }
 
 //PAGEBREAK: 32
-// Look in the process table for an UNUSED proc.
-// If found, change state to EMBRYO and initialize
-// state required to run in the kernel.
-// Otherwise return 0.
+// Allocate a proc, add it to the process table in state EMBRYO
+// and initialize state required to run in the kernel.
+// Return 0 if out of memory.
 static struct proc*
 allocproc(void)
 {
   struct proc *p;
   char *sp;
 
-  acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-    if(p->state == UNUSED)
-      goto found;
-  release(&ptable.lock);
-  return 0;
-
-found:
-  p->state = EMBRYO;
-  p->pid = nextpid++;
-  release(&ptable.lock);
+  if((p = kmem_cache_alloc(&ptable.cache)) == 0)
+    return 0;
 
   // Allocate kernel stack.
   if((p->kstack = kalloc()) == 0){
-    p->state = UNUSED;
+    kmem_cache_free(&ptable.cache, p);
     return 0;
   }
+
+  acquire(&ptable.lock);
+  // Objects come from memory as needed, but a bound on processes
+  // keeps a fork loop from exhausting memory that inodes and
+  // buffers must then do without.
+  if(ptable.nproc >= NPROC){
+    release(&ptable.lock);
+    kfree(p->kstack);
+    kmem_cache_free(&ptable.cache, p);
+    return 0;
+  }
+  p->state = EMBRYO;
+  p->pid = nextpid++;
+  p->next = ptable.list;
+  if(ptable.list)
+    ptable.list->prev = p;
+  ptable.list = p;
+  ptable.nproc++;
+  p->hashnext = ptable.pidhash[p->pid % NPIDHASH];
+  ptable.pidhash[p->pid % NPIDHASH] = p;
+  release(&ptable.lock);
+
   sp = p->kstack + KSTACKSIZE;
   
   // Leave room for trap frame.
@@ -83,6 +113,7 @@ userinit(void)
   
   p = allocproc();
   initproc = p;
+  p->pgid = p->pid;
   if((p->pgdir = setupkvm()) == 0)
     panic("userinit: out of memory?");
   inituvm(p->pgdir, _binary_initcode_start, (int)_binary_initcode_size);
@@ -116,9 +147,9 @@ growproc(int n)
   } else if(n < 0){
     if((sz = deallocuvm(proc->pgdir, sz, sz + n)) == 0)
       return -1;
+    flushtlb();
   }
   proc->sz = sz;
-  switchuvm(proc);
   return 0;
 }
 
@@ -137,13 +168,15 @@ fork(void)
 
   // Copy process state from p.
   if((np->pgdir = copyuvm(proc->pgdir, proc->sz)) == 0){
-    kfree(np->kstack);
-    np->kstack = 0;
-    np->state = UNUSED;
+    acquire(&ptable.lock);
+    freeproc(np);
+    release(&ptable.lock);
     return -1;
   }
   np->sz = proc->sz;
-  np->parent = proc;
+  np->pgid = proc->pgid;
+  np->sigblocked = proc->sigblocked;
+  memmove(np->sigact, proc->sigact, sizeof(np->sigact));
   *np->tf = *proc->tf;
 
   // Clear %eax so that fork returns 0 in the child.
@@ -160,17 +193,21 @@ fork(void)
 
   // lock to force the compiler to emit the np->state write last.
   acquire(&ptable.lock);
+  np->parent = proc;
+  np->sibling = proc->children;
+  proc->children = np;
   np->state = RUNNABLE;
   release(&ptable.lock);
   
   return pid;
 }
 
-// Exit the current process.  Does not return.
+// Exit the current process with the given wait status.
+// Does not return.
 // An exited process remains in the zombie state
-// until its parent calls wait() to find out it exited.
+// until its parent calls wait4() to find out it exited.
 void
-exit(void)
+exit(int status)
 {
   struct proc *p;
   int fd;
@@ -195,65 +232,127 @@ exit(void)
 
   // Parent might be sleeping in wait().
   wakeup1(proc->parent);
+  psignal(proc->parent, SIGCHLD);
 
   // Pass abandoned children to init.
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->parent == proc){
+  if(proc->children){
+    for(p = proc->children; ; p = p->sibling){
       p->parent = initproc;
       if(p->state == ZOMBIE)
         wakeup1(initproc);
+      if(p->sibling == 0)
+        break;
     }
+    p->sibling = initproc->children;
+    initproc->children = proc->children;
+    proc->children = 0;
   }
 
   // Jump into the scheduler, never to return.
+  proc->xstate = status;
   proc->state = ZOMBIE;
   sched();
   panic("zombie exit");
 }
 
-// Wait for a child process to exit and return its pid.
-// Return -1 if this process has no children.
+static void
+addrusage(struct rusage *a, struct rusage *b)
+{
+  a->ticks += b->ticks;
+  a->pgfault += b->pgfault;
+  a->inblock += b->inblock;
+  a->oublock += b->oublock;
+}
+
+// Wait for child pid (any child if pid is -1) to exit and
+// return its pid.  If status is not 0, store its exit status
+// there; if ru is not 0, store the resources it and its own
+// reaped children used.  With WNOHANG in options, return 0
+// rather than sleep if no such child has exited yet.  With
+// WUNTRACED, also return children that have stopped, once
+// per stop.
+// Return -1 if this process has no such child.
 int
-wait(void)
+wait4(int pid, int *status, int options, struct rusage *ru)
 {
-  struct proc *p;
-  int havekids, pid;
+  struct proc *p, **pp;
+  int found;
 
   acquire(&ptable.lock);
   for(;;){
-    // Scan through table looking for zombie children.
-    havekids = 0;
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->parent != proc)
+    // Scan through children looking for zombies.
+    found = 0;
+    for(pp = &proc->children; (p = *pp) != 0; pp = &p->sibling){
+      if(pid != -1 && p->pid != pid)
         continue;
-      havekids = 1;
+      found = 1;
+      if((options & WUNTRACED) && p->stopped && !p->stopreported){
+        p->stopreported = 1;
+        if(status)
+          *status = p->stopped << 8 | 0x7f;
+        release(&ptable.lock);
+        return p->pid;
+      }
       if(p->state == ZOMBIE){
         // Found one.
+        *pp = p->sibling;
         pid = p->pid;
-        kfree(p->kstack);
-        p->kstack = 0;
+        addrusage(&p->ru, &p->cru);
+        addrusage(&proc->cru, &p->ru);
+        if(status)
+          *status = p->xstate;
+        if(ru)
+          *ru = p->ru;
         freevm(p->pgdir);
-        p->state = UNUSED;
-        p->pid = 0;
-        p->parent = 0;
-        p->name[0] = 0;
-        p->killed = 0;
+        freeproc(p);
         release(&ptable.lock);
         return pid;
       }
     }
 
-    // No point waiting if we don't have any children.
-    if(!havekids || proc->killed){
+    // No point waiting if we don't have any such children.
+    if(!found || issig()){
       release(&ptable.lock);
       return -1;
     }
+    if(options & WNOHANG){
+      release(&ptable.lock);
+      return 0;
+    }
 
     // Wait for children to exit.  (See wakeup1 call in proc_exit.)
     sleep(proc, &ptable.lock);  //DOC: wait-sleep
   }
 }
 
+int
+wait(void)
+{
+  return wait4(-1, 0, 0, 0);
+}
+
+// Take p off the process table and free it and its kernel stack.
+// Caller must hold ptable.lock, have freed p->pgdir and have
+// taken p off its parent's list of children.
+static void
+freeproc(struct proc *p)
+{
+  struct proc **pp;
+
+  if(p->prev)
+    p->prev->next = p->next;
+  else
+    ptable.list = p->next;
+  if(p->next)
+    p->next->prev = p->prev;
+  for(pp = &ptable.pidhash[p->pid % NPIDHASH]; *pp != p; pp = &(*pp)->hashnext)
+    ;
+  *pp = p->hashnext;
+  ptable.nproc--;
+  kfree(p->kstack);
+  kmem_cache_free(&ptable.cache, p);
+}
+
 //PAGEBREAK: 42
 // Per-CPU process scheduler.
 // Each CPU calls scheduler() after setting itself up.
@@ -262,10 +361,17 @@ wait(void)
 //  - swtch to start running that process
 //  - eventually that process transfers control
 //      via swtch back to the scheduler.
+// After a process gives up the CPU the search continues round
+// the table from the next process, ending at that process itself,
+// without switching to the kernel page table in between: if the
+// same process is picked again, switchuvm() need not reload %cr3.
+// Only a CPU that finds nothing to run goes back to kpgdir, before
+// it lets go of ptable.lock (see loadpgdir in vm.c).
 void
 scheduler(void)
 {
   struct proc *p;
+  int n;
 
   for(;;){
     // Enable interrupts on this processor.
@@ -273,7 +379,8 @@ scheduler(void)
 
     // Loop over process table looking for process to run.
     acquire(&ptable.lock);
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    p = ptable.list;
+    for(n = ptable.nproc; n > 0; n--, p = p->next ? p->next : ptable.list){
       if(p->state != RUNNABLE)
         continue;
 
@@ -283,36 +390,242 @@ scheduler(void)
       proc = p;
       switchuvm(p);
       p->state = RUNNING;
+      cpu->nswitch++;
       swtch(&cpu->scheduler, proc->context);
-      switchkvm();
 
       // Process is done running for now.
       // It should have changed its p->state before coming back.
       proc = 0;
+      n = ptable.nproc + 1;
     }
+    switchkvm();
     release(&ptable.lock);
+  }
+}
+
+
+// Mark p stopped by signal sig.  It parks itself when it
+// next returns to user space (see checkstop).
+// Caller must hold ptable.lock.
+static void
+stopproc(struct proc *p, int sig)
+{
+  p->stopped = sig;
+  p->stopreported = 0;
+  wakeup1(p->parent);
+}
+
+// Post signal sig to p.  SIGKILL, SIGCONT and unblocked
+// default stops act at once; signals that would be ignored are
+// dropped; the rest are left pending for p to deliver to itself
+// on its way back to user space (see trap.c).
+// Caller must hold ptable.lock.
+static void
+psignal(struct proc *p, int sig)
+{
+  sighandler_t h;
+
+  if(sig == SIGKILL){
+    p->killed = SIGKILL;
+    // Wake process from sleep if necessary.
+    if(p->state == SLEEPING)
+      p->state = RUNNABLE;
+    return;
+  }
+  if(sig == SIGCONT){
+    p->sigpending &= ~SIGSTOPMASK;
+    if(p->stopped){
+      p->stopped = 0;
+      wakeup1(&p->stopped);
+    }
+  }
+  if(sigbit(sig) & SIGSTOPMASK)
+    p->sigpending &= ~sigbit(SIGCONT);
+
+  h = p->sigact[sig].sa_handler;
+  if(h == SIG_IGN || (h == SIG_DFL && (sigbit(sig) & SIGIGNMASK)))
+    return;
+  if(h == SIG_DFL && (sigbit(sig) & SIGSTOPMASK) &&
+     !(p->sigblocked & sigbit(sig))){
+    // A stop does not interrupt a sleep.
+    stopproc(p, sig);
+    return;
+  }
+  p->sigpending |= sigbit(sig);
+  if(!(p->sigblocked & sigbit(sig)) && p->state == SLEEPING)
+    p->state = RUNNABLE;
+}
+
+// Send signal sig to every process in group pgid.
+// Signal 0 only checks that the group exists.
+// Return -1 if there is no such process.
+int
+killpg(int pgid, int sig)
+{
+  struct proc *p;
+  int found;
 
+  if(pgid <= 0 || sig < 0 || sig >= NSIG)
+    return -1;
+  found = 0;
+  acquire(&ptable.lock);
+  for(p = ptable.list; p; p = p->next){
+    if(p->pgid == pgid && p->state != ZOMBIE){
+      if(sig)
+        psignal(p, sig);
+      found = 1;
+    }
   }
+  release(&ptable.lock);
+  return found ? 0 : -1;
 }
 
+// Return non-zero if the current process has been killed or
+// has a signal to deliver, so that a sleep in a system call
+// should be cut short.
+int
+issig(void)
+{
+  return proc->killed || (proc->sigpending & ~proc->sigblocked);
+}
 
+// Remove and return the lowest-numbered deliverable signal
+// pending for the current process, or 0 if there is none.
+int
+nextsig(void)
+{
+  uint pend;
+  int sig;
+
+  acquire(&ptable.lock);
+  pend = proc->sigpending & ~proc->sigblocked;
+  for(sig = 1; sig < NSIG; sig++)
+    if(pend & sigbit(sig))
+      break;
+  if(sig == NSIG)
+    sig = 0;
+  else
+    proc->sigpending &= ~sigbit(sig);
+  release(&ptable.lock);
+  return sig;
+}
+
+// Stop the current process because of signal sig,
+// until it is continued or killed.
 void
-sendsignal(int sig)
+stopself(int sig)
 {
-  struct proc *p;
-  if (sig == 1){ // kill
+  acquire(&ptable.lock);
+  stopproc(proc, sig);
+  release(&ptable.lock);
+  checkstop();
+}
+
+// Set the action for signal sig to *act, if act is not 0,
+// after saving the old one in *oact, if oact is not 0.
+int
+sigaction(int sig, struct sigaction *act, struct sigaction *oact)
+{
+  sighandler_t h;
+
+  if(sig <= 0 || sig >= NSIG)
+    return -1;
+  if(act && (sig == SIGKILL || sig == SIGSTOP))
+    return -1;
+  if(act && act->sa_handler != SIG_DFL && act->sa_handler != SIG_IGN &&
+     act->sa_restorer == 0)
+    return -1;
+  if(oact)
+    *oact = proc->sigact[sig];
+  if(act){
     acquire(&ptable.lock);
-    for(p = &ptable.proc[NPROC] -1; p >= ptable.proc; p--){
-      if(p->pid){
-        p->killed = 1;
-        if(p->state == SLEEPING){
-          p->state = RUNNABLE;
-        }
-        break;
-      }
+    proc->sigact[sig] = *act;
+    proc->sigact[sig].sa_mask &= ~(sigbit(SIGKILL)|sigbit(SIGSTOP));
+    // A signal that is now ignored is discarded.
+    h = act->sa_handler;
+    if(h == SIG_IGN || (h == SIG_DFL && (sigbit(sig) & SIGIGNMASK)))
+      proc->sigpending &= ~sigbit(sig);
+    release(&ptable.lock);
+  }
+  return 0;
+}
+
+// Change the current process's blocked signals as how says,
+// after saving the old mask in *oset, if oset is not 0.
+int
+sigprocmask(int how, uint *set, uint *oset)
+{
+  uint mask;
+
+  acquire(&ptable.lock);
+  mask = proc->sigblocked;
+  if(oset)
+    *oset = mask;
+  if(set){
+    switch(how){
+    case SIG_BLOCK:
+      mask |= *set;
+      break;
+    case SIG_UNBLOCK:
+      mask &= ~*set;
+      break;
+    case SIG_SETMASK:
+      mask = *set;
+      break;
+    default:
+      release(&ptable.lock);
+      return -1;
     }
+    proc->sigblocked = mask & ~(sigbit(SIGKILL)|sigbit(SIGSTOP));
+  }
+  release(&ptable.lock);
+  return 0;
+}
+
+// Put process pid (the caller if 0), which must be the caller
+// or one of its children, in process group pgid (its own
+// group if 0).
+int
+setpgid(int pid, int pgid)
+{
+  struct proc *p;
+
+  if(pid < 0 || pgid < 0)
+    return -1;
+  acquire(&ptable.lock);
+  p = pid == 0 ? proc : findproc(pid);
+  if(p == 0 || (p != proc && p->parent != proc)){
     release(&ptable.lock);
+    return -1;
   }
+  p->pgid = pgid == 0 ? p->pid : pgid;
+  release(&ptable.lock);
+  return 0;
+}
+
+// Return the process group of process pid (the caller if 0).
+int
+getpgid(int pid)
+{
+  struct proc *p;
+  int pgid;
+
+  acquire(&ptable.lock);
+  p = pid == 0 ? proc : findproc(pid);
+  pgid = p ? p->pgid : -1;
+  release(&ptable.lock);
+  return pgid;
+}
+
+// Park the current process, which is about to return to user
+// space, until it is continued or killed.
+void
+checkstop(void)
+{
+  acquire(&ptable.lock);
+  while(proc->stopped && !proc->killed)
+    sleep(&proc->stopped, &ptable.lock);
+  release(&ptable.lock);
 }
 
 // Enter scheduler.  Must hold only ptable.lock
@@ -410,7 +723,7 @@ wakeup1(void *chan)
 {
   struct proc *p;
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+  for(p = ptable.list; p; p = p->next)
     if(p->state == SLEEPING && p->chan == chan)
       p->state = RUNNABLE;
 }
@@ -424,27 +737,42 @@ wakeup(void *chan)
   release(&ptable.lock);
 }
 
-// Kill the process with the given pid.
-// Process won't exit until it returns
+// Return the process with the given pid, or 0.
+// Caller must hold ptable.lock.
+static struct proc*
+findproc(int pid)
+{
+  struct proc *p;
+
+  for(p = ptable.pidhash[pid % NPIDHASH]; p; p = p->hashnext)
+    if(p->pid == pid)
+      return p;
+  return 0;
+}
+
+// Send signal sig to the process with the given pid, to every
+// process in group -pid if pid is negative, or to the caller's
+// group if pid is 0.  Signal 0 only checks that the target exists.
+// The process won't act on the signal until it returns
 // to user space (see trap in trap.c).
 int
-kill(int pid)
+kill(int pid, int sig)
 {
   struct proc *p;
 
+  if(sig < 0 || sig >= NSIG)
+    return -1;
+  if(pid <= 0)
+    return killpg(pid == 0 ? proc->pgid : -pid, sig);
   acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->pid == pid){
-      p->killed = 1;
-      // Wake process from sleep if necessary.
-      if(p->state == SLEEPING)
-        p->state = RUNNABLE;
-      release(&ptable.lock);
-      return 0;
-    }
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -1;
   }
+  if(sig)
+    psignal(p, sig);
   release(&ptable.lock);
-  return -1;
+  return 0;
 }
 
 //PAGEBREAK: 36
@@ -467,14 +795,13 @@ procdump(void)
   char *state;
   uint pc[10];
   
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->state == UNUSED)
-      continue;
+  for(p = ptable.list; p; p = p->next){
     if(p->state >= 0 && p->state < NELEM(states) && states[p->state])
       state = states[p->state];
     else
       state = "???";
-    cprintf("%d %s %s", p->pid, state, p->name);
+    cprintf("%d %d %s %s%s", p->pid, p->pgid, state, p->name,
+            p->stopped ? " (stopped)" : "");
     if(p->state == SLEEPING){
       getcallerpcs((uint*)p->context->ebp+2, pc);
       for(i=0; i<10 && pc[i] != 0; i++)
@@ -482,4 +809,20 @@ procdump(void)
     }
     cprintf("\n");
   }
+  for(i = 0; i < ncpu; i++)
+    cprintf("cpu%d: %d switches %d tlb flushes\n",
+            cpus[i].id, cpus[i].nswitch, cpus[i].ntlbflush);
+}
+
+// Sum the context switch and TLB flush counts of all CPUs.
+void
+cpustat(uint *nswitch, uint *ntlbflush)
+{
+  int i;
+
+  *nswitch = *ntlbflush = 0;
+  for(i = 0; i < ncpu; i++){
+    *nswitch += cpus[i].nswitch;
+    *ntlbflush += cpus[i].ntlbflush;
+  }
 }
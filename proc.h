@@ -10,6 +10,9 @@ struct cpu {
   volatile uint started;       // Has the CPU started?
   int ncli;                    // Depth of pushcli nesting.
   int intena;                  // Were interrupts enabled before pushcli?
+  pde_t *pgdir;                // Page table loaded in %cr3 (see loadpgdir)
+  uint nswitch;                // Number of switches into a process
+  uint ntlbflush;              // Number of %cr3 loads, each a TLB flush
   
   // Cpu-local storage variables; see below
   struct cpu *cpu;
@@ -62,10 +65,24 @@ struct proc {
   struct trapframe *tf;        // Trap frame for current syscall
   struct context *context;     // swtch() here to run process
   void *chan;                  // If non-zero, sleeping on chan
-  int killed;                  // If non-zero, have been killed
+  int killed;                  // If non-zero, killed by this signal
+  int pgid;                    // Process group ID
+  int stopped;                 // If non-zero, stopped by this signal
+  int stopreported;            // Stop has been reported by wait4()
+  uint sigpending;             // Signals posted but not yet delivered
+  uint sigblocked;             // Signals not to be delivered for now
+  struct sigaction sigact[NSIG]; // What to do with each signal
+  int xstate;                  // Exit status, for parent's wait4()
+  struct rusage ru;            // Resources used by this process
+  struct rusage cru;           // Resources used by reaped children
   struct file *ofile[NOFILE];  // Open files
   struct inode *cwd;           // Current directory
   char name[16];               // Process name (debugging)
+  struct proc *next;           // Next on ptable.list
+  struct proc *prev;           // Previous on ptable.list
+  struct proc *hashnext;       // Next on pid hash chain
+  struct proc *children;       // First child
+  struct proc *sibling;        // Next child of parent
 };
 
 // Process memory is laid out contiguously, low addresses first:
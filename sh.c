@@ -3,17 +3,23 @@
 #include "types.h"
 #include "user.h"
 #include "fcntl.h"
-#include "history.h"
 #include "stat.h"
 #include "fs.h"
+#include "wait.h"
+#include "signal.h"
+#include "exechash.h"
 // Parsed command representation
 #define EXEC  1
 #define REDIR 2
 #define PIPE  3
 #define LIST  4
 #define BACK  5
-
-#define MAXARGS 10
+#define SUBSHELL 6   // uses struct backcmd
+#define AND   7      // &&, uses struct listcmd
+#define OR    8      // ||, uses struct listcmd
+#define IF    9
+#define WHILE 10
+#define FOR   11
 
 struct cmd {
   int type;
@@ -21,8 +27,10 @@ struct cmd {
 
 struct execcmd {
   int type;
-  char *argv[MAXARGS];
-  char *eargv[MAXARGS];
+  int argc;
+  int size;      // slots in argv and eargv, which grow as needed
+  char **argv;   // null-terminated
+  char **eargv;
 };
 
 struct redircmd {
@@ -46,57 +54,1146 @@ struct listcmd {
   struct cmd *right;
 };
 
-struct backcmd {
-  int type;
-  struct cmd *cmd;
-};
+struct backcmd {
+  int type;
+  struct cmd *cmd;
+};
+
+struct ifcmd {
+  int type;
+  struct cmd *cond;
+  struct cmd *then;
+  struct cmd *els;     // 0 if no else
+};
+
+struct whilecmd {
+  int type;
+  struct cmd *cond;
+  struct cmd *body;
+};
+
+struct forcmd {
+  int type;
+  struct execcmd *words;  // loop variable, then the words after "in"
+  struct cmd *body;
+};
+
+#define INBUF 4096    // first buffer size for readfile()
+#define MAXLINE 1025  // longest console line, with newline and nul
+
+int readline(FILE*, char*, int);
+char *readfile(int);
+
+// Command history.  HISTLOG is an append-only log of commands,
+// one per line, and HISTIDX holds each command's offset in the log
+// as a uint, so any command can be fetched with two seeks.  Only
+// the newest hist.size commands are kept in memory: startup reads
+// just those, and older ones are read back from the log on demand.
+// New commands are appended to both files HISTBATCH at a time,
+// holding HISTLOCK so that another shell's appends cannot land
+// between a log write and its index write.  Each command is also
+// pushed to the console, whose line editor keeps its own copy for
+// the arrow keys and ^R.
+#define HISTLOG   "/.history"
+#define HISTIDX   "/.histidx"
+#define HISTLOCK  "/.histlock"
+#define HISTBREAK "/.histbreak"
+#define HISTSIZE  100  // default window; $HISTSIZE overrides
+#define HISTBATCH 8
+
+struct {
+  int n;         // number of commands
+  int ondisk;    // commands before this one are in the files
+  int size;      // slots in win, at least HISTBATCH
+  char **win;    // command i in win[i%size] for n-size <= i < n
+  char *old;     // last command read back from the log
+} hist;
+
+void histload(void);
+int histlock(void);
+void histunlock(void);
+void histadd(char*);
+char *histget(int);
+void histflush(void);
+
+int fork1(void);  // Fork but panics on failure.
+void panic(char*);
+struct cmd *parsecmd(char*);
+int evalcmd(struct cmd*);
+
+static int updatecurrentpath(char*, char*);
+
+char currentpath[255];  // Current directory, ending in '/'
+int laststatus;         // Exit status of the last command
+int jobcontrol;         // Run commands as jobs with their own process group
+int interrupted;        // ^C came while the shell had the console
+char jobname[MAXLINE];  // Text of the command line being run
+
+//PAGEBREAK!
+// Arenas.  Command trees are allocated from cmdarena, which is
+// emptied after each interactive command line.  Expanded words
+// and argument vectors come from exparena, and are released as
+// soon as the command using them has run.  Neither calls free()
+// per object, so the shell's heap stays flat however many
+// commands it runs.
+
+#define ARENACHUNK 4096
+
+struct chunk {
+  struct chunk *next;  // older chunk
+  uint size;           // bytes of memory after this header
+  uint used;
+};
+
+struct arena {
+  struct chunk *cur;   // newest chunk
+};
+
+struct amark {
+  struct chunk *c;
+  uint used;
+};
+
+struct arena cmdarena;
+struct arena exparena;
+
+void*
+aalloc(struct arena *a, uint n)
+{
+  struct chunk *c;
+  char *p;
+
+  n = (n + 3) & ~3;
+  if((c = a->cur) == 0 || c->used + n > c->size){
+    c = malloc(sizeof(*c) + (n > ARENACHUNK ? n : ARENACHUNK));
+    if(c == 0)
+      panic("arena: out of memory");
+    c->size = n > ARENACHUNK ? n : ARENACHUNK;
+    c->used = 0;
+    c->next = a->cur;
+    a->cur = c;
+  }
+  p = (char*)(c + 1) + c->used;
+  c->used += n;
+  return p;
+}
+
+char*
+astrdup(struct arena *a, char *s)
+{
+  char *t;
+
+  t = aalloc(a, strlen(s) + 1);
+  strcpy(t, s);
+  return t;
+}
+
+struct amark
+amark(struct arena *a)
+{
+  struct amark m;
+
+  m.c = a->cur;
+  m.used = a->cur ? a->cur->used : 0;
+  return m;
+}
+
+// Free everything allocated from a since mark m.
+void
+arelease(struct arena *a, struct amark m)
+{
+  struct chunk *c;
+
+  while(a->cur != m.c){
+    c = a->cur;
+    a->cur = c->next;
+    free(c);
+  }
+  if(a->cur)
+    a->cur->used = m.used;
+}
+
+// Empty a, keeping its oldest chunk for reuse.
+void
+areset(struct arena *a)
+{
+  struct chunk *c;
+
+  while(a->cur && a->cur->next){
+    c = a->cur;
+    a->cur = c->next;
+    free(c);
+  }
+  if(a->cur)
+    a->cur->used = 0;
+}
+
+//PAGEBREAK!
+// Builtins, run by the shell itself without forking.
+
+int
+builtin_cd(int argc, char **argv)
+{
+  char *dir;
+
+  dir = argc > 1 ? argv[1] : "/";
+  if(chdir(dir) < 0){
+    printf(2, "cannot cd %s\n", dir);
+    return 1;
+  }
+  updatecurrentpath(dir, currentpath);
+  return 0;
+}
+
+int
+builtin_pwd(int argc, char **argv)
+{
+  int n;
+
+  n = strlen(currentpath);
+  if(n == 1){
+    printf(1, "/\n");
+    return 0;
+  }
+  currentpath[n-1] = 0;  // drop trailing '/'
+  printf(1, "%s\n", currentpath);
+  currentpath[n-1] = '/';
+  return 0;
+}
+
+// history [n]: list the last n commands, or all of them.
+int
+builtin_history(int argc, char **argv)
+{
+  int i;
+
+  i = 0;
+  if(argc > 1 && (i = hist.n - atoi(argv[1])) < 0)
+    i = 0;
+  for(; i < hist.n; i++)
+    printf(1, "%d %s\n", i+1, histget(i));
+  return 0;
+}
+
+int
+builtin_echo(int argc, char **argv)
+{
+  int i;
+
+  for(i = 1; i < argc; i++)
+    printf(1, "%s%s", argv[i], i+1 < argc ? " " : "\n");
+  if(argc < 2)
+    printf(1, "\n");
+  return 0;
+}
+
+int
+builtin_exit(int argc, char **argv)
+{
+  histflush();
+  exit(argc > 1 ? atoi(argv[1]) : laststatus);
+}
+
+int
+samename(char *a, char *b, int n)
+{
+  while(n > 0 && *a == *b)
+    n--, a++, b++;
+  return n == 0;
+}
+
+// Shell variables, in a hash table keyed by name.
+// Exported ones are passed to commands in their environment.
+#define NVARHASH 31
+
+struct var {
+  char *name;
+  char *value;
+  int exported;
+  struct var *next;   // hash chain
+};
+
+struct var *vartab[NVARHASH];
+
+int
+isnamechar(int c, int first)
+{
+  return c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+    (!first && c >= '0' && c <= '9');
+}
+
+// Length of the variable name at the start of s, 0 if none.
+int
+namelen(char *s)
+{
+  int n;
+
+  for(n = 0; isnamechar(s[n], n == 0); n++)
+    ;
+  return n;
+}
+
+struct var**
+varslot(char *name, int n)
+{
+  struct var **vp;
+  uint h;
+  int i;
+
+  h = 0;
+  for(i = 0; i < n; i++)
+    h = h*31 + name[i];
+  for(vp = &vartab[h % NVARHASH]; *vp; vp = &(*vp)->next)
+    if(strlen((*vp)->name) == n && samename((*vp)->name, name, n))
+      break;
+  return vp;
+}
+
+// Set the variable whose name is the n bytes at name.
+struct var*
+setvar(char *name, int n, char *value, int export)
+{
+  struct var **vp, *v;
+
+  vp = varslot(name, n);
+  if((v = *vp) == 0){
+    v = malloc(sizeof(*v));
+    memset(v, 0, sizeof(*v));
+    v->name = malloc(n+1);
+    memmove(v->name, name, n);
+    v->name[n] = 0;
+    *vp = v;
+  } else
+    free(v->value);
+  v->value = malloc(strlen(value)+1);
+  strcpy(v->value, value);
+  if(export)
+    v->exported = 1;
+  return v;
+}
+
+// Return the value of the variable whose name is the n bytes
+// at name, or 0 if it is not set.
+char*
+getvar(char *name, int n)
+{
+  struct var *v;
+
+  if((v = *varslot(name, n)) == 0)
+    return 0;
+  return v->value;
+}
+
+// Import an environment of name=value strings.
+void
+importenv(char **envp)
+{
+  int n;
+
+  for(; envp && *envp; envp++)
+    if((n = namelen(*envp)) > 0 && (*envp)[n] == '=')
+      setvar(*envp, n, *envp+n+1, 1);
+}
+
+// Build the environment for a command: name=value for
+// each exported variable.
+char**
+makeenv(void)
+{
+  struct var *v;
+  char **envp;
+  int i, n;
+
+  n = 0;
+  for(i = 0; i < NVARHASH; i++)
+    for(v = vartab[i]; v; v = v->next)
+      n += v->exported;
+  envp = malloc((n+1) * sizeof(envp[0]));
+  n = 0;
+  for(i = 0; i < NVARHASH; i++){
+    for(v = vartab[i]; v; v = v->next){
+      if(!v->exported)
+        continue;
+      envp[n] = malloc(strlen(v->name) + strlen(v->value) + 2);
+      strcpy(envp[n], v->name);
+      strcpy(envp[n] + strlen(v->name), "=");
+      strcpy(envp[n] + strlen(v->name) + 1, v->value);
+      n++;
+    }
+  }
+  envp[n] = 0;
+  return envp;
+}
+
+int
+builtin_export(int argc, char **argv)
+{
+  struct var *v;
+  int i, n, status;
+
+  if(argc < 2){
+    for(i = 0; i < NVARHASH; i++)
+      for(v = vartab[i]; v; v = v->next)
+        if(v->exported)
+          printf(1, "export %s=%s\n", v->name, v->value);
+    return 0;
+  }
+  status = 0;
+  for(i = 1; i < argc; i++){
+    n = namelen(argv[i]);
+    if(n == 0 || (argv[i][n] != '=' && argv[i][n] != 0)){
+      printf(2, "export: bad variable %s\n", argv[i]);
+      status = 1;
+    } else if(argv[i][n] == '=')
+      setvar(argv[i], n, argv[i]+n+1, 1);
+    else if((v = *varslot(argv[i], n)) != 0)
+      v->exported = 1;
+    else
+      setvar(argv[i], n, "", 1);
+  }
+  return status;
+}
+
+int
+builtin_set(int argc, char **argv)
+{
+  struct var *v;
+  int i;
+
+  for(i = 0; i < NVARHASH; i++)
+    for(v = vartab[i]; v; v = v->next)
+      printf(1, "%s=%s\n", v->name, v->value);
+  return 0;
+}
+
+int
+builtin_unset(int argc, char **argv)
+{
+  struct var **vp, *v;
+  int i;
+
+  for(i = 1; i < argc; i++){
+    vp = varslot(argv[i], strlen(argv[i]));
+    if((v = *vp) == 0)
+      continue;
+    *vp = v->next;
+    free(v->name);
+    free(v->value);
+    free(v);
+  }
+  return 0;
+}
+
+int
+builtin_true(int argc, char **argv)
+{
+  return 0;
+}
+
+int
+builtin_false(int argc, char **argv)
+{
+  return 1;
+}
+
+// test expr, or [ expr ].  A builtin so that loop and if
+// conditions do not fork.  Returns 0 if true, 1 if false,
+// 2 if expr is malformed.
+int
+builtin_test(int argc, char **argv)
+{
+  struct stat st;
+  int not, a, b;
+  char *op;
+
+  if(strcmp(argv[0], "[") == 0){
+    if(strcmp(argv[argc-1], "]") != 0){
+      printf(2, "[: missing ]\n");
+      return 2;
+    }
+    argc--;
+  }
+  argv++;
+  argc--;
+  not = 0;
+  if(argc > 0 && strcmp(argv[0], "!") == 0){
+    not = 1;
+    argv++;
+    argc--;
+  }
+  switch(argc){
+  case 0:
+    return !not;
+  case 1:
+    return (argv[0][0] == 0) ^ not;
+  case 2:
+    op = argv[0];
+    if(strcmp(op, "-n") == 0)
+      return (argv[1][0] == 0) ^ not;
+    if(strcmp(op, "-z") == 0)
+      return (argv[1][0] != 0) ^ not;
+    if(strcmp(op, "-e") == 0)
+      return (stat(argv[1], &st) < 0) ^ not;
+    if(strcmp(op, "-f") == 0)
+      return (stat(argv[1], &st) < 0 || st.type != T_FILE) ^ not;
+    if(strcmp(op, "-d") == 0)
+      return (stat(argv[1], &st) < 0 || st.type != T_DIR) ^ not;
+    break;
+  case 3:
+    op = argv[1];
+    if(strcmp(op, "=") == 0)
+      return (strcmp(argv[0], argv[2]) != 0) ^ not;
+    if(strcmp(op, "!=") == 0)
+      return (strcmp(argv[0], argv[2]) == 0) ^ not;
+    a = atoi(argv[0]);
+    b = atoi(argv[2]);
+    if(strcmp(op, "-eq") == 0)
+      return !(a == b) ^ not;
+    if(strcmp(op, "-ne") == 0)
+      return !(a != b) ^ not;
+    if(strcmp(op, "-lt") == 0)
+      return !(a < b) ^ not;
+    if(strcmp(op, "-le") == 0)
+      return !(a <= b) ^ not;
+    if(strcmp(op, "-gt") == 0)
+      return !(a > b) ^ not;
+    if(strcmp(op, "-ge") == 0)
+      return !(a >= b) ^ not;
+    break;
+  }
+  printf(2, "test: bad expression\n");
+  return 2;
+}
+
+struct builtin *findbuiltin(char*);
+
+int
+builtin_type(int argc, char **argv)
+{
+  char buf[HASHPATH];
+  int i, status;
+
+  status = 0;
+  for(i = 1; i < argc; i++){
+    if(findbuiltin(argv[i])){
+      printf(1, "%s is a shell builtin\n", argv[i]);
+      continue;
+    }
+    // Ask the kernel, which searches /path as exec() does.
+    if(lookpath(argv[i], buf, sizeof(buf)) == 0){
+      printf(1, "%s is %s\n", argv[i], buf);
+      continue;
+    }
+    printf(2, "%s: not found\n", argv[i]);
+    status = 1;
+  }
+  return status;
+}
+
+// hash: list the kernel's cache of command lookups.
+// hash name...: look names up, adding them to the cache.
+// hash -r, rehash: empty the cache and re-read /path.
+int
+builtin_hash(int argc, char **argv)
+{
+  static struct hashent h[32];  // as many as the kernel keeps
+  char buf[HASHPATH];
+  int i, n, status;
+
+  if(strcmp(argv[0], "rehash") == 0 ||
+     (argc > 1 && strcmp(argv[1], "-r") == 0)){
+    rehash();
+    return 0;
+  }
+  if(argc < 2){
+    n = hashstat(h, sizeof(h)/sizeof(h[0]));
+    for(i = 0; i < n; i++)
+      printf(1, "%d\t%s\t%s\n", h[i].hits, h[i].name,
+             h[i].path[0] ? h[i].path : "(not found)");
+    return 0;
+  }
+  status = 0;
+  for(i = 1; i < argc; i++){
+    if(lookpath(argv[i], buf, sizeof(buf)) < 0){
+      printf(2, "hash: %s: not found\n", argv[i]);
+      status = 1;
+    }
+  }
+  return status;
+}
+
+int builtin_jobs(int, char**);
+int builtin_fg(int, char**);
+int builtin_bg(int, char**);
+
+struct builtin {
+  char *name;
+  int (*fn)(int, char**);
+} builtins[] = {
+  { "cd",      builtin_cd },
+  { "pwd",     builtin_pwd },
+  { "history", builtin_history },
+  { "echo",    builtin_echo },
+  { "exit",    builtin_exit },
+  { "export",  builtin_export },
+  { "set",     builtin_set },
+  { "unset",   builtin_unset },
+  { "type",    builtin_type },
+  { "hash",    builtin_hash },
+  { "rehash",  builtin_hash },
+  { "jobs",    builtin_jobs },
+  { "fg",      builtin_fg },
+  { "bg",      builtin_bg },
+  { "true",    builtin_true },
+  { "false",   builtin_false },
+  { "test",    builtin_test },
+  { "[",       builtin_test },
+};
+
+struct builtin*
+findbuiltin(char *name)
+{
+  struct builtin *b;
+
+  for(b = builtins; b < &builtins[sizeof(builtins)/sizeof(builtins[0])]; b++)
+    if(strcmp(b->name, name) == 0)
+      return b;
+  return 0;
+}
+
+// A word being expanded, built up in exparena.
+struct word {
+  char *s;
+  int n;
+  int size;
+};
+
+// Append the n bytes at s to w.
+void
+wordput(struct word *w, char *s, int n)
+{
+  char *t;
+
+  if(w->n + n > w->size){
+    w->size = 2*(w->n + n);
+    t = aalloc(&exparena, w->size);
+    memmove(t, w->s, w->n);
+    w->s = t;
+  }
+  memmove(w->s + w->n, s, n);
+  w->n += n;
+}
+
+// Return word with $name, ${name} and $? replaced by the values
+// of those variables ($? is the status of the last command).
+// Unset variables expand to nothing.
+char*
+expandword(char *word)
+{
+  struct word x;
+  char *w, *s, *v, num[12];
+  int n, st;
+
+  if(strchr(word, '$') == 0)
+    return word;
+  memset(&x, 0, sizeof(x));
+  for(w = word; *w; ){
+    if(*w != '$'){
+      for(s = w; *w && *w != '$'; w++)
+        ;
+      wordput(&x, s, w - s);
+      continue;
+    }
+    w++;
+    if(*w == '?'){
+      w++;
+      s = num + sizeof(num);
+      st = laststatus;
+      do {
+        *--s = '0' + st % 10;
+      } while((st /= 10) != 0);
+      wordput(&x, s, num + sizeof(num) - s);
+    } else if(*w == '{' && (n = namelen(w+1)) > 0 && w[1+n] == '}'){
+      if((v = getvar(w+1, n)) != 0)
+        wordput(&x, v, strlen(v));
+      w += n + 2;
+    } else if((n = namelen(w)) > 0){
+      if((v = getvar(w, n)) != 0)
+        wordput(&x, v, strlen(v));
+      w += n;
+    } else
+      wordput(&x, "$", 1);
+  }
+  wordput(&x, "", 1);
+  return x.s;
+}
+
+// A growable, null-terminated array of strings.
+struct strv {
+  int n;
+  int size;
+  char **v;
+};
+
+void
+strvpush(struct strv *sv, char *s)
+{
+  char **v;
+
+  if(sv->n + 1 >= sv->size){
+    sv->size = sv->size ? 2*sv->size : 8;
+    v = aalloc(&exparena, sv->size * sizeof(v[0]));
+    if(sv->n > 0)
+      memmove(v, sv->v, sv->n * sizeof(v[0]));
+    sv->v = v;
+  }
+  sv->v[sv->n++] = s;
+  sv->v[sv->n] = 0;
+}
+
+// Glob patterns.  Each /-separated component of a pattern is
+// compiled into tokens: a star, or the set of characters that one
+// name character must be in (a literal, ? or a [...] class).
+// globmatch keeps a single backtrack point, just after the last
+// star seen, so no pattern takes more than length(name) steps per
+// token, unlike backtracking over every star.
+struct gtok {
+  int star;
+  uchar set[32];  // bitmap of matching characters
+};
+
+struct glob {
+  int n;
+  struct gtok *t;
+};
+
+// If p starts a [...] class, return the closing ], else 0.
+// A ] right after [ or [! is part of the class.
+char*
+classend(char *p)
+{
+  p++;
+  if(*p == '!' || *p == '^')
+    p++;
+  if(*p == ']')
+    p++;
+  while(*p && *p != ']')
+    p++;
+  return *p ? p : 0;
+}
+
+int
+checkWildcards(char *s)
+{
+  for(; *s; s++)
+    if(*s == '*' || *s == '?' || (*s == '[' && classend(s)))
+      return 1;
+  return 0;
+}
+
+void
+globcompile(struct glob *g, char *p)
+{
+  struct gtok *t;
+  char *e;
+  int c, hi, i, neg;
+
+  g->t = aalloc(&exparena, (strlen(p)+1) * sizeof(g->t[0]));
+  g->n = 0;
+  while(*p){
+    t = &g->t[g->n++];
+    memset(t, 0, sizeof(*t));
+    if(*p == '*'){
+      while(*p == '*')
+        p++;
+      t->star = 1;
+    } else if(*p == '?'){
+      memset(t->set, 0xff, sizeof(t->set));
+      p++;
+    } else if(*p == '[' && (e = classend(p)) != 0){
+      p++;
+      neg = (*p == '!' || *p == '^');
+      if(neg)
+        p++;
+      while(p < e){
+        c = hi = (uchar)*p++;
+        if(*p == '-' && p+1 < e){
+          hi = (uchar)p[1];
+          p += 2;
+        }
+        for(; c <= hi; c++)
+          t->set[c/8] |= 1 << (c%8);
+      }
+      if(neg)
+        for(i = 0; i < sizeof(t->set); i++)
+          t->set[i] ^= 0xff;
+      p = e+1;
+    } else {
+      c = (uchar)*p++;
+      t->set[c/8] |= 1 << (c%8);
+    }
+  }
+}
+
+int
+globmatch(struct glob *g, char *name)
+{
+  struct gtok *t;
+  char *s, *star;
+  int i, c, restart;
+
+  s = name;
+  i = 0;
+  restart = -1;  // token after the last star, or -1
+  star = 0;      // where that star's match ends
+  while(*s){
+    if(i < g->n){
+      t = &g->t[i];
+      if(t->star){
+        restart = ++i;
+        star = s;
+        continue;
+      }
+      c = (uchar)*s;
+      if(t->set[c/8] & (1 << (c%8))){
+        i++;
+        s++;
+        continue;
+      }
+    }
+    if(restart < 0)
+      return 0;
+    i = restart;
+    s = ++star;
+  }
+  while(i < g->n && g->t[i].star)
+    i++;
+  return i == g->n;
+}
+
+// Return dir followed by name (and a / if slash), in exparena.
+char*
+pathcat(char *dir, char *name, int slash)
+{
+  struct word x;
+
+  memset(&x, 0, sizeof(x));
+  wordput(&x, dir, strlen(dir));
+  wordput(&x, name, strlen(name));
+  if(slash)
+    wordput(&x, "/", 1);
+  wordput(&x, "", 1);
+  return x.s;
+}
+
+// Sort the n strings v.
+void
+sortstrv(char **v, int n)
+{
+  int gap, i, j;
+  char *s;
+
+  for(gap = n/2; gap > 0; gap /= 2)
+    for(i = gap; i < n; i++)
+      for(j = i; j >= gap && strcmp(v[j-gap], v[j]) > 0; j -= gap){
+        s = v[j];
+        v[j] = v[j-gap];
+        v[j-gap] = s;
+      }
+}
+
+// Directory listings read while globbing or completing, kept
+// between commands in sorted order, so a name or prefix can be
+// found by binary search.  An entry is good while its directory's
+// inode generation is unchanged, which the kernel moves on every
+// write to the directory (and when it drops the inode from its
+// cache), so a hit costs one stat instead of reading it all.
+#define NDIRCACHE 8
+
+struct dircache {
+  int dev;
+  uint ino;
+  uint gen;
+  int n;
+  char *names;  // n names, DIRSIZ+1 bytes each, sorted
+  uint used;    // dirclock when last used; 0 if free
+} dircache[NDIRCACHE];
+uint dirclock;
+
+#define DIRNAME(d, i) ((d)->names + (i)*(DIRSIZ+1))
+
+// Return the listing of directory dir ("" for the current one),
+// without . and .., reading it if it is not cached.  The entry
+// is good until the next call.  Return 0 if dir is unreadable.
+struct dircache*
+dirlookup(char *dir)
+{
+  struct dircache *d, *victim;
+  struct dirent de;
+  struct stat st;
+  struct strv names;
+  struct amark m;
+  char *s;
+  int fd, i;
+
+  if(*dir == 0)
+    dir = ".";
+  if(stat(dir, &st) < 0 || st.type != T_DIR)
+    return 0;
+  victim = dircache;
+  for(d = dircache; d < &dircache[NDIRCACHE]; d++){
+    if(d->used && d->dev == st.dev && d->ino == st.ino)
+      break;
+    if(d->used < victim->used)
+      victim = d;
+  }
+  if(d < &dircache[NDIRCACHE] && d->gen == st.gen){
+    d->used = ++dirclock;
+    return d;
+  }
+  if(d == &dircache[NDIRCACHE])
+    d = victim;
+
+  if((fd = open(dir, O_RDONLY)) < 0)
+    return 0;
+  // Take the generation from the open directory, so that a
+  // change made after it is read invalidates the listing.
+  if(fstat(fd, &st) < 0 || st.type != T_DIR){
+    close(fd);
+    return 0;
+  }
+  m = amark(&exparena);
+  memset(&names, 0, sizeof(names));
+  while(read(fd, &de, sizeof(de)) == sizeof(de)){
+    if(de.inum == 0)
+      continue;
+    s = aalloc(&exparena, DIRSIZ+1);
+    memmove(s, de.name, DIRSIZ);
+    s[DIRSIZ] = 0;
+    if(strcmp(s, ".") != 0 && strcmp(s, "..") != 0)
+      strvpush(&names, s);
+  }
+  close(fd);
+  sortstrv(names.v, names.n);
+
+  if(d->names)
+    free(d->names);
+  d->dev = st.dev;
+  d->ino = st.ino;
+  d->gen = st.gen;
+  d->n = names.n;
+  d->names = malloc(d->n * (DIRSIZ+1) + 1);
+  for(i = 0; i < d->n; i++)
+    memmove(DIRNAME(d, i), names.v[i], DIRSIZ+1);
+  d->used = ++dirclock;
+  arelease(&exparena, m);
+  return d;
+}
+
+// Append the names in directory dir ("" for the current one)
+// to names, leaving out . and ..  Return -1 if dir is unreadable.
+int
+listdir(char *dir, struct strv *names)
+{
+  struct dircache *d;
+  char *s;
+  int i;
+
+  if((d = dirlookup(dir)) == 0)
+    return -1;
+  s = aalloc(&exparena, d->n * (DIRSIZ+1));
+  memmove(s, d->names, d->n * (DIRSIZ+1));
+  for(i = 0; i < d->n; i++)
+    strvpush(names, s + i*(DIRSIZ+1));
+  return 0;
+}
+
+// Append to out the paths under dir (which is "" or ends in /)
+// that match the n pattern components comp.  A ** component
+// matches any number of directories.  Names starting with .
+// only match components that start with one too.
+void
+globwalk(char *dir, char **comp, int n, struct strv *out)
+{
+  struct strv names;
+  struct glob g;
+  struct stat st;
+  char *path;
+  int i;
+
+  if(!checkWildcards(comp[0])){
+    path = pathcat(dir, comp[0], n > 1);
+    if(n > 1)
+      globwalk(path, comp+1, n-1, out);
+    else if(stat(path, &st) >= 0)
+      strvpush(out, path);
+    return;
+  }
+  memset(&names, 0, sizeof(names));
+  if(listdir(dir, &names) < 0)
+    return;
+  if(n > 1 && strcmp(comp[0], "**") == 0){
+    globwalk(dir, comp+1, n-1, out);
+    for(i = 0; i < names.n; i++){
+      if(names.v[i][0] == '.')
+        continue;
+      path = pathcat(dir, names.v[i], 1);
+      if(stat(path, &st) >= 0 && st.type == T_DIR)
+        globwalk(path, comp, n, out);
+    }
+    return;
+  }
+  globcompile(&g, comp[0]);
+  for(i = 0; i < names.n; i++){
+    if(names.v[i][0] == '.' && comp[0][0] != '.')
+      continue;
+    if(!globmatch(&g, names.v[i]))
+      continue;
+    path = pathcat(dir, names.v[i], n > 1);
+    if(n == 1)
+      strvpush(out, path);
+    else if(stat(path, &st) >= 0 && st.type == T_DIR)
+      globwalk(path, comp+1, n-1, out);
+  }
+}
+
+// Append to out the paths that match pattern pat.
+// Return how many there were.
+int
+globexpand(char *pat, struct strv *out)
+{
+  struct strv comp;
+  char *p;
+  int n;
+
+  memset(&comp, 0, sizeof(comp));
+  p = astrdup(&exparena, pat);
+  strvpush(&comp, p);
+  for(; *p; p++)
+    if(*p == '/'){
+      *p = 0;
+      strvpush(&comp, p+1);
+    }
+  n = out->n;
+  globwalk("", comp.v, comp.n, out);
+  return out->n - n;
+}
+
+// Append to out the words w expands to with its first {...}
+// group that has a top-level comma replaced by each alternative
+// in turn, and those words' groups expanded likewise:
+// a{b,c{d,e}}f gives abf acdf acef.
+void
+braceexpand(char *w, struct strv *out)
+{
+  struct word x;
+  char *open, *close, *alt, *p;
+  int depth, comma;
+
+  close = 0;
+  for(open = w; (open = strchr(open, '{')) != 0; open++){
+    depth = comma = 0;
+    for(p = open; *p; p++){
+      if(*p == '{')
+        depth++;
+      else if(*p == '}' && --depth == 0)
+        break;
+      else if(*p == ',' && depth == 1)
+        comma = 1;
+    }
+    if(*p && comma){
+      close = p;
+      break;
+    }
+  }
+  if(close == 0){
+    strvpush(out, w);
+    return;
+  }
+  for(alt = open+1; alt <= close; alt = p+1){
+    depth = 0;
+    for(p = alt; p < close; p++){
+      if(*p == '{')
+        depth++;
+      else if(*p == '}')
+        depth--;
+      else if(*p == ',' && depth == 0)
+        break;
+    }
+    memset(&x, 0, sizeof(x));
+    wordput(&x, w, open - w);
+    wordput(&x, alt, p - alt);
+    wordput(&x, close+1, strlen(close+1));
+    wordput(&x, "", 1);
+    braceexpand(x.s, out);
+  }
+}
+
+// Return a copy of words, in exparena, with variables expanded,
+// then braces expanded, and each word with wildcards replaced by
+// the paths it matches, so that $d/*.c globs in directory $d.
+// Set *argcp to the number of arguments.
+char**
+expandargs(char **words, int *argcp)
+{
+  struct strv args, alts;
+  int i, j;
 
-struct history hs;
+  memset(&args, 0, sizeof(args));
+  for(i = 0; words[i]; i++){
+    memset(&alts, 0, sizeof(alts));
+    braceexpand(expandword(words[i]), &alts);
+    for(j = 0; j < alts.n; j++)
+      if(!checkWildcards(alts.v[j]) || globexpand(alts.v[j], &args) == 0)
+        strvpush(&args, alts.v[j]);  // no match: keep the pattern
+  }
+  if(args.v == 0){  // no words
+    args.v = aalloc(&exparena, sizeof(args.v[0]));
+    args.v[0] = 0;
+  }
+  *argcp = args.n;
+  return args.v;
+}
 
-void initHistory(struct history* hs);
-void addHistory(struct history* hs,char* cmd);
-void getHistory(struct history* hs);
-void setHistory(char* cmd);
+// Number of name=value assignments at the start of words.
+int
+nassign(char **words)
+{
+  int i, n;
 
-#define FILENUMBER 100
-#define FILELENGTH 128
+  for(i = 0; words[i]; i++)
+    if((n = namelen(words[i])) == 0 || words[i][n] != '=')
+      break;
+  return i;
+}
 
-struct fileList
+// Perform the first n words of words, which are assignments.
+void
+assign(char **words, int n, int export)
 {
-  int len;
-  char list[FILENUMBER][FILELENGTH];
-};
-struct fileList filelist;
-struct fileList templist;
-void printFilelsit(struct fileList* fl);
-void getFilelist(char *path,struct fileList *fl);
-void addFilelist(struct fileList *fl,char* filename);
-void initFilelist();
-char* fmtname(char *path);
-int matchesPattern( char* input, char* pattern);
-int checkWildcards(char *str);
-void getMatchList(char* filename,struct fileList *allfile,struct fileList *matchfile);
+  int i, len;
 
-int fork1(void);  // Fork but panics on failure.
-void panic(char*);
-struct cmd *parsecmd(char*);
+  for(i = 0; i < n; i++){
+    len = namelen(words[i]);
+    setvar(words[i], len, expandword(words[i]+len+1), export);
+  }
+}
 
-// Execute cmd.  Never returns.
+// Execute cmd in a child process.  Never returns.
 void
 runcmd(struct cmd *cmd)
 {
   int p[2];
   struct backcmd *bcmd;
   struct execcmd *ecmd;
-  struct listcmd *lcmd;
   struct pipecmd *pcmd;
   struct redircmd *rcmd;
-
-  initFilelist(&filelist);
-  initFilelist(&templist);
+  struct builtin *b;
+  char **argv, *file;
+  int argc, n, pid, status;
 
   if(cmd == 0)
-    exit();
+    exit(0);
   
   switch(cmd->type){
   default:
@@ -104,49 +1201,36 @@ runcmd(struct cmd *cmd)
 
   case EXEC:
     ecmd = (struct execcmd*)cmd;
-    if(ecmd->argv[0] == 0)
-      exit();
-
-    //add wildcard judgement
-    getFilelist(".",&filelist);
-    int i;
-    for(i = 1;ecmd->argv[i] != 0;i++){
-      if(checkWildcards(ecmd->argv[i])){
-        getMatchList(ecmd->argv[i],&filelist,&templist);
-      }
-    }
-    for(i = 0;i < templist.len;i++){
-      if(ecmd->argv[i+1] == 0){
-        ecmd->argv[i+1] = malloc((MAXARGS)*sizeof(char));
-        ecmd->argv[i+1][0] = '\0';
-      }
-      int l = strlen(templist.list[i]);
-      strcpy(ecmd->argv[i+1],templist.list[i]);
-      ecmd->argv[i+1][l] = '\0';
-    }
-
-
-    exec(ecmd->argv[0], ecmd->argv);
-    printf(2,"exec %s failed\n", ecmd->argv[0]);
-    break;
+    // Assignments before a command are for its environment only.
+    n = nassign(ecmd->argv);
+    assign(ecmd->argv, n, 1);
+    if(ecmd->argv[n] == 0)
+      exit(0);
+    argv = expandargs(ecmd->argv + n, &argc);
+    if((b = findbuiltin(argv[0])) != 0)
+      exit(b->fn(argc, argv));
+    execve(argv[0], argv, makeenv());
+    printf(2,"exec %s failed\n", argv[0]);
+    exit(1);
 
   case REDIR:
     rcmd = (struct redircmd*)cmd;
     close(rcmd->fd);
-    if(open(rcmd->file, rcmd->mode) < 0){
-      printf(2, "open %s failed\n", rcmd->file);
-      exit();
+    file = expandword(rcmd->file);
+    if(open(file, rcmd->mode) < 0){
+      printf(2, "open %s failed\n", file);
+      exit(1);
     }
     runcmd(rcmd->cmd);
     break;
 
   case LIST:
-    lcmd = (struct listcmd*)cmd;
-    if(fork1() == 0)
-      runcmd(lcmd->left);
-    wait();
-    runcmd(lcmd->right);
-    break;
+  case AND:
+  case OR:
+  case IF:
+  case WHILE:
+  case FOR:
+    exit(evalcmd(cmd));
 
   case PIPE:
     pcmd = (struct pipecmd*)cmd;
@@ -159,7 +1243,7 @@ runcmd(struct cmd *cmd)
       close(p[1]);
       runcmd(pcmd->left);
     }
-    if(fork1() == 0){
+    if((pid = fork1()) == 0){
       close(0);
       dup(p[0]);
       close(p[0]);
@@ -168,23 +1252,538 @@ runcmd(struct cmd *cmd)
     }
     close(p[0]);
     close(p[1]);
+    // The pipeline's status is that of its last command.
+    waitpid(pid, &status, 0);
     wait();
-    wait();
-    break;
+    exit(WIFEXITED(status) ? WEXITSTATUS(status) : 1);
     
   case BACK:
     bcmd = (struct backcmd*)cmd;
     if(fork1() == 0)
       runcmd(bcmd->cmd);
     break;
+
+  case SUBSHELL:
+    runcmd(((struct backcmd*)cmd)->cmd);
+    break;
+  }
+  exit(0);
+}
+
+// Jobs started by the shell.  Each job runs in its own process
+// group, led by the child the shell forks for it, so that ^C and
+// ^Z reach only the foreground job.  Finished background jobs
+// are reaped, and their cost reported, before each prompt.
+#define NJOB 16
+
+#define JRUN  1
+#define JSTOP 2
+
+struct job {
+  int pid;               // also the pgid; 0 if slot is free
+  int state;             // JRUN or JSTOP
+  char cmd[100];
+} jobs[NJOB];
+
+struct job*
+findjob(int pid)
+{
+  struct job *j;
+
+  for(j = jobs; j < &jobs[NJOB]; j++)
+    if(j->pid != 0 && j->pid == pid)
+      return j;
+  return 0;
+}
+
+struct job*
+addjob(int pid, int state, char *cmd)
+{
+  struct job *j;
+  int n;
+
+  for(j = jobs; j < &jobs[NJOB]; j++){
+    if(j->pid == 0){
+      j->pid = pid;
+      j->state = state;
+      n = strlen(cmd);
+      if(n >= sizeof(j->cmd))
+        n = sizeof(j->cmd) - 1;
+      memmove(j->cmd, cmd, n);
+      while(n > 0 && strchr(" \t\r\n\v", j->cmd[n-1]))
+        n--;
+      j->cmd[n] = 0;
+      return j;
+    }
+  }
+  printf(2, "sh: too many jobs\n");
+  return 0;
+}
+
+void
+printjob(struct job *j)
+{
+  printf(2, "[%d] %d %s %s\n", (int)(j - jobs) + 1, j->pid,
+         j->state == JSTOP ? "stopped" : "running", j->cmd);
+}
+
+// Reap background jobs that have finished or stopped, without
+// blocking, and report what each finished one cost.
+void
+reapjobs(void)
+{
+  struct rusage ru;
+  struct job *j;
+  int pid, status;
+
+  while((pid = wait4(-1, &status, WNOHANG|WUNTRACED, &ru)) > 0){
+    j = findjob(pid);
+    if(WIFSTOPPED(status)){
+      if(j){
+        j->state = JSTOP;
+        printjob(j);
+      }
+      continue;
+    }
+    if(j){
+      printf(2, "[%d] %d done %s", (int)(j - jobs) + 1, pid, j->cmd);
+      j->pid = 0;
+    } else
+      printf(2, "[?] %d done", pid);
+    if(WIFEXITED(status))
+      printf(2, " (exit %d", WEXITSTATUS(status));
+    else
+      printf(2, " (signal %d", WTERMSIG(status));
+    printf(2, ", %d ticks, %d faults, %d blocks in, %d out)\n",
+           ru.ticks, ru.pgfault, ru.inblock, ru.oublock);
   }
-  exit();
 }
 
+// Give the console to job pid and wait until it exits or stops.
+// Return its exit status, or 128 plus the signal that ended or
+// stopped it.
 int
-getcmd(char *buf, int nbuf, char *currentpath)
+waitfg(int pid, char *cmd)
+{
+  struct job *j;
+  int status;
+
+  tcsetpgrp(pid);
+  // A ^C that reached the shell before the job had the console
+  // cuts the wait short; wait again while the job is there.
+  while(waitpid(pid, &status, WUNTRACED) < 0){
+    if(kill(pid, 0) < 0){
+      status = 0;
+      break;
+    }
+  }
+  tcsetpgrp(getpid());
+  j = findjob(pid);
+  if(WIFSTOPPED(status)){
+    if(j == 0)
+      j = addjob(pid, JSTOP, cmd);
+    if(j){
+      j->state = JSTOP;
+      printf(2, "\n");
+      printjob(j);
+    }
+  } else {
+    if(WIFSIGNALED(status))
+      printf(2, "\n");
+    if(j)
+      j->pid = 0;
+  }
+  if(WIFSTOPPED(status))
+    return 128 + WSTOPSIG(status);
+  if(WIFSIGNALED(status))
+    return 128 + WTERMSIG(status);
+  return WEXITSTATUS(status);
+}
+
+// Return the job named by arg ("n" or "%n"), or the most
+// recently started job if arg is empty.
+struct job*
+getjob(char *arg)
+{
+  struct job *j;
+  int n;
+
+  if(*arg == 0){
+    for(j = &jobs[NJOB-1]; j >= jobs; j--)
+      if(j->pid)
+        return j;
+    printf(2, "sh: no current job\n");
+    return 0;
+  }
+  if(*arg == '%')
+    arg++;
+  n = atoi(arg);
+  if(n < 1 || n > NJOB || jobs[n-1].pid == 0){
+    printf(2, "sh: no such job\n");
+    return 0;
+  }
+  return &jobs[n-1];
+}
+
+int
+builtin_jobs(int argc, char **argv)
+{
+  struct job *j;
+
+  for(j = jobs; j < &jobs[NJOB]; j++)
+    if(j->pid)
+      printjob(j);
+  return 0;
+}
+
+int
+builtin_fg(int argc, char **argv)
+{
+  struct job *j;
+
+  if((j = getjob(argc > 1 ? argv[1] : "")) == 0)
+    return 1;
+  printf(2, "%s\n", j->cmd);
+  j->state = JRUN;
+  tcsetpgrp(j->pid);
+  killpg(j->pid, SIGCONT);
+  return waitfg(j->pid, j->cmd);
+}
+
+int
+builtin_bg(int argc, char **argv)
+{
+  struct job *j;
+
+  if((j = getjob(argc > 1 ? argv[1] : "")) == 0)
+    return 1;
+  j->state = JRUN;
+  killpg(j->pid, SIGCONT);
+  printjob(j);
+  return 0;
+}
+
+// Fork a child to run cmd.  In the interactive shell the child
+// leads a new job; wait for it to finish or stop unless bg.
+// Return its exit status, or 0 for a background job.
+int
+runjob(struct cmd *cmd, int bg)
+{
+  struct job *j;
+  int pid, status;
+
+  if((pid = fork1()) == 0){
+    if(jobcontrol){
+      setpgid(0, 0);
+      signal(SIGINT, SIG_DFL);
+    }
+    jobcontrol = 0;
+    runcmd(cmd);
+  }
+  if(!jobcontrol){
+    if(bg)
+      return 0;
+    if(waitpid(pid, &status, 0) < 0)
+      return 1;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+  }
+  // Also here, in case the child has not run yet.
+  setpgid(pid, pid);
+  if(bg){
+    if((j = addjob(pid, JRUN, jobname)) != 0)
+      printf(2, "[%d] %d\n", (int)(j - jobs) + 1, pid);
+    return 0;
+  }
+  return waitfg(pid, jobname);
+}
+
+// Run a for loop, setting its variable to each word in turn.
+int
+evalfor(struct forcmd *fcmd)
+{
+  struct amark m;
+  char **argv;
+  int i, n, status;
+
+  m = amark(&exparena);
+  argv = expandargs(fcmd->words->argv, &n);
+  if(namelen(argv[0]) != strlen(argv[0])){
+    printf(2, "for: bad variable %s\n", argv[0]);
+    arelease(&exparena, m);
+    return 1;
+  }
+  status = 0;
+  for(i = 1; i < n; i++){
+    setvar(argv[0], strlen(argv[0]), argv[i], 0);
+    status = laststatus = evalcmd(fcmd->body);
+    if(status == 128+SIGINT)
+      break;
+  }
+  arelease(&exparena, m);
+  return status;
+}
+
+// Run cmd and return its exit status.  Builtins, lists, control
+// flow and redirections are handled in this process; external
+// commands, pipelines and subshells are forked.
+int
+evalcmd(struct cmd *cmd)
+{
+  struct execcmd *ecmd;
+  struct listcmd *lcmd;
+  struct ifcmd *icmd;
+  struct whilecmd *wcmd;
+  struct redircmd *rcmd;
+  struct builtin *b;
+  struct amark m;
+  char **argv, *file;
+  int argc, n, sfd, status;
+
+again:
+  if(cmd == 0)
+    return 0;
+  // ^C stops a list or loop of builtins at the next command.
+  if(interrupted)
+    return 128+SIGINT;
+
+  switch(cmd->type){
+  default:
+    panic("evalcmd");
+
+  case EXEC:
+    ecmd = (struct execcmd*)cmd;
+    if(ecmd->argv[0] == 0)
+      return 0;
+    // A command of only assignments sets shell variables.
+    n = nassign(ecmd->argv);
+    m = amark(&exparena);
+    if(ecmd->argv[n] == 0){
+      assign(ecmd->argv, n, 0);
+      arelease(&exparena, m);
+      return 0;
+    }
+    // Look the command up by its expanded name, so that $x
+    // naming cd or export runs here too.
+    if(n == 0){
+      argv = expandargs(ecmd->argv, &argc);
+      if((b = findbuiltin(argv[0])) != 0){
+        status = b->fn(argc, argv);
+        arelease(&exparena, m);
+        return status;
+      }
+    }
+    arelease(&exparena, m);
+    return runjob(cmd, 0);
+
+  case REDIR:
+    rcmd = (struct redircmd*)cmd;
+    // Save the descriptor being replaced, and put it back after.
+    sfd = dup(rcmd->fd);
+    // Buffered output goes where it was written for: to the old
+    // descriptor here, and to the file after the command.
+    fflush(stdout);
+    fflush(stderr);
+    close(rcmd->fd);
+    m = amark(&exparena);
+    file = expandword(rcmd->file);
+    if(open(file, rcmd->mode) < 0){
+      printf(2, "open %s failed\n", file);
+      status = 1;
+    } else {
+      status = evalcmd(rcmd->cmd);
+      fflush(stdout);
+      fflush(stderr);
+      close(rcmd->fd);
+    }
+    if(sfd >= 0){
+      dup(sfd);
+      close(sfd);
+    }
+    arelease(&exparena, m);
+    return status;
+
+  case LIST:
+    // Iterate down the list rather than recursing, so that a long
+    // script does not run the shell out of stack.
+    lcmd = (struct listcmd*)cmd;
+    laststatus = evalcmd(lcmd->left);
+    cmd = lcmd->right;
+    goto again;
+
+  case AND:
+  case OR:
+    lcmd = (struct listcmd*)cmd;
+    status = evalcmd(lcmd->left);
+    if((status == 0) != (cmd->type == AND))
+      return status;
+    laststatus = status;
+    cmd = lcmd->right;
+    goto again;
+
+  case IF:
+    icmd = (struct ifcmd*)cmd;
+    laststatus = evalcmd(icmd->cond);
+    cmd = laststatus == 0 ? icmd->then : icmd->els;
+    goto again;
+
+  case WHILE:
+    wcmd = (struct whilecmd*)cmd;
+    status = 0;
+    while((laststatus = evalcmd(wcmd->cond)) == 0){
+      status = laststatus = evalcmd(wcmd->body);
+      if(status == 128+SIGINT)
+        break;
+    }
+    return interrupted ? 128+SIGINT : status;
+
+  case FOR:
+    return evalfor((struct forcmd*)cmd);
+
+  case PIPE:
+  case SUBSHELL:
+    return runjob(cmd, 0);
+
+  case BACK:
+    return runjob(((struct backcmd*)cmd)->cmd, 1);
+  }
+}
+
+// Tab completion.  When Tab is typed at the prompt, the console
+// passes the line up to the cursor, ended by a nul instead of a
+// newline, and inserts whatever complete() is given.  The last
+// word is completed as a command if it begins a command and has
+// no /, and as a file name otherwise.
+
+// Append to out the names in dir that start with prefix, leaving
+// out those starting with . unless prefix does.  The sorted
+// listing puts them together, after the first name not less
+// than prefix.
+void
+dirmatch(char *dir, char *prefix, struct strv *out)
+{
+  struct dircache *d;
+  int lo, hi, mid, n;
+
+  if((d = dirlookup(dir)) == 0)
+    return;
+  lo = 0;
+  hi = d->n;
+  while(lo < hi){
+    mid = (lo + hi) / 2;
+    if(strcmp(DIRNAME(d, mid), prefix) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  n = strlen(prefix);
+  for(; lo < d->n && samename(DIRNAME(d, lo), prefix, n); lo++)
+    if(DIRNAME(d, lo)[0] != '.' || prefix[0] == '.')
+      strvpush(out, astrdup(&exparena, DIRNAME(d, lo)));
+}
+
+// Append to out the builtins and the commands in the directories
+// listed in /path that start with prefix.
+void
+cmdmatch(char *prefix, struct strv *out)
+{
+  struct builtin *b;
+  char *path, *p, *q;
+  int fd, n;
+
+  n = strlen(prefix);
+  for(b = builtins; b < &builtins[sizeof(builtins)/sizeof(builtins[0])]; b++)
+    if(samename(b->name, prefix, n))
+      strvpush(out, b->name);
+  if((fd = open("/path", O_RDONLY)) < 0)
+    return;
+  path = readfile(fd);
+  close(fd);
+  for(p = path; *p; p = q){
+    while(*p && strchr("; \t\r\n", *p))
+      p++;
+    for(q = p; *q && !strchr("; \t\r\n", *q); q++)
+      ;
+    if(q > p){
+      if(*q)
+        *q++ = 0;
+      dirmatch(p, prefix, out);
+    }
+  }
+  free(path);
+}
+
+// Complete the last word of line, which came from the console.
+// Insert what all the matches have in common beyond the word, and
+// a / or space after a single match.  If that is nothing and
+// there are several matches, list them and return 1.
+int
+completeword(char *line)
+{
+  struct strv m;
+  struct word dir;
+  struct stat st;
+  char *w, *p, add[DIRSIZ+2];
+  int i, n, cmd, uniq;
+
+  w = line + strlen(line);
+  while(w > line && !strchr(" \t|;&<>()", w[-1]))
+    w--;
+  for(p = w; p > line && strchr(" \t", p[-1]); p--)
+    ;
+  cmd = p == line || strchr("|;&(", p[-1]);
+
+  memset(&m, 0, sizeof(m));
+  memset(&dir, 0, sizeof(dir));
+  for(p = w + strlen(w); p > w && p[-1] != '/'; p--)
+    ;
+  wordput(&dir, w, p - w);
+  wordput(&dir, "", 1);
+  if(cmd && p == w)
+    cmdmatch(w, &m);
+  else
+    dirmatch(dir.s, p, &m);
+  if(m.n == 0)
+    return 0;
+
+  n = strlen(m.v[0]);
+  for(i = 1; i < m.n; i++)
+    while(!samename(m.v[0], m.v[i], n))
+      n--;
+  uniq = 1;
+  for(i = 0; i < m.n; i++)
+    if(strlen(m.v[i]) != n)
+      uniq = 0;
+  if(uniq || n > strlen(p)){
+    i = n - strlen(p);
+    memmove(add, m.v[0] + strlen(p), i);
+    if(uniq){
+      if(cmd && p == w)
+        add[i++] = ' ';
+      else if(stat(pathcat(dir.s, m.v[0], 0), &st) >= 0 && st.type == T_DIR)
+        add[i++] = '/';
+      else
+        add[i++] = ' ';
+    }
+    add[i] = 0;
+    complete(add);
+    return 0;
+  }
+
+  sortstrv(m.v, m.n);
+  printf(2, "\n");
+  for(i = 0; i < m.n; i++)
+    if(i == 0 || strcmp(m.v[i], m.v[i-1]) != 0)
+      printf(2, "%s  ", m.v[i]);
+  printf(2, "\n");
+  return 1;
+}
+
+void
+prompt(char *currentpath)
 {
   int len;
+
+  fflush(stdout);  // builtins' output comes first
   if (currentpath[1] != 0){
     currentpath[(len = strlen(currentpath)) - 1] = 0;
     printf(2, "%s$ ", currentpath);
@@ -192,12 +1791,96 @@ getcmd(char *buf, int nbuf, char *currentpath)
   }else{
     printf(2, "%s$ ", currentpath);
   }
-  
-  memset(buf, 0, nbuf);
-  gets(buf, nbuf);
-  if(buf[0] == 0) // EOF
-    return -1;
-  return 0;
+}
+
+int
+getcmd(char *buf, int nbuf, char *currentpath)
+{
+  struct amark m;
+  int n;
+
+  for(;;){
+    prompt(currentpath);
+    // Answer completion requests until a whole line comes.
+    while((n = readline(stdin, buf, nbuf)) > 0 && buf[n-1] == 0){
+      m = amark(&exparena);
+      if(completeword(buf)){
+        prompt(currentpath);
+        complete("");  // show the line again after the prompt
+      }
+      arelease(&exparena, m);
+    }
+    if(n > 0)
+      return 0;
+    if(!interrupted) // EOF
+      return -1;
+    // ^C cut the read short: drop the line and start another.
+    interrupted = 0;
+    printf(2, "\n");
+  }
+}
+
+// ^C with the shell in the foreground: at the prompt, or while
+// it runs builtins.  evalcmd and getcmd look at the flag.
+void
+onintr(int sig)
+{
+  interrupted = 1;
+}
+
+// Read a line, including its newline, from f into buf.
+// A nul also ends a line, and is counted.
+// Returns the number of bytes stored, 0 at end of file.
+int
+readline(FILE *f, char *buf, int nbuf)
+{
+  int i, c;
+
+  for(i = 0; i+1 < nbuf; ){
+    if((c = fgetc(f)) == EOF)
+      break;
+    buf[i++] = c;
+    if(c == '\n' || c == 0)
+      break;
+  }
+  buf[i] = 0;
+  return i;
+}
+
+// Read all of fd into a malloc'd, nul-terminated string.
+char*
+readfile(int fd)
+{
+  char *buf, *nbuf;
+  int n, len, size;
+
+  size = INBUF;
+  len = 0;
+  buf = malloc(size+1);
+  while((n = read(fd, buf+len, size-len)) > 0){
+    len += n;
+    if(len == size){
+      nbuf = malloc(2*size+1);
+      memmove(nbuf, buf, len);
+      free(buf);
+      buf = nbuf;
+      size *= 2;
+    }
+  }
+  buf[len] = 0;
+  return buf;
+}
+
+// Parse all of script into one command tree, then run it.
+// Returns the exit status of the last command.
+int
+runscript(char *script)
+{
+  struct cmd *cmd;
+
+  if((cmd = parsecmd(script)) == 0)
+    return 2;
+  return evalcmd(cmd);
 }
 
 static char*
@@ -266,15 +1949,30 @@ updatecurrentpath(char *path, char *currentpath)
 
 
 int
-main(void)
+main(int argc, char *argv[], char *envp[])
 {
-  static char buf[100];
+  static char buf[MAXLINE];
+  struct cmd *cmd;
+  char *script;
   int fd;
-  initHistory(&hs);
-  getHistory(&hs);
-  passHistory(&hs);
+
+  importenv(envp);
+  // sh -c 'cmd' and sh script: no prompt, history or job control.
+  if(argc > 2 && strcmp(argv[1], "-c") == 0)
+    exit(runscript(argv[2]));
+  if(argc > 1){
+    if((fd = open(argv[1], O_RDONLY)) < 0){
+      printf(2, "sh: cannot open %s\n", argv[1]);
+      exit(127);
+    }
+    script = readfile(fd);
+    close(fd);
+    exit(runscript(script));
+  }
+
+  histpush(0);  // a new console history session
+  histload();
   
-  char currentpath[255];
   // Assumes three file descriptors open.
   while((fd = open("console", O_RDWR)) >= 0){
     if(fd >= 3){
@@ -283,28 +1981,30 @@ main(void)
     }
   }
   strcpy(currentpath, "/");
-  // Read and run input commands.
-  while(getcmd(buf, sizeof(buf), currentpath) >= 0){
-    addHistory(&hs, buf);
-    passHistory(&hs);
-    setHistory(buf);
-    if(buf[0] == 'c' && buf[1] == 'd' && buf[2] == ' '){
-      // Clumsy but will have to do for now.
-      // Chdir has no effect on the parent if run in the child.
-      buf[strlen(buf)-1] = 0;  // chop \n
-      if(chdir(buf+3) < 0){
-        printf(2, "cannot cd %s\n", buf+3);
-      }else{
-        updatecurrentpath(buf+3, currentpath);    
-      }
+  // Lead a process group of our own, and keep the console for
+  // it while no job is in the foreground.
+  setpgid(0, 0);
+  tcsetpgrp(getpid());
+  jobcontrol = 1;
+  signal(SIGINT, onintr);
+  // Read and run input commands.
+  for(;;){
+    reapjobs();
+    interrupted = 0;
+    if(getcmd(buf, sizeof(buf), currentpath) < 0)
+      break;
+    histadd(buf);
+    strcpy(jobname, buf);  // buf is cut up by parsecmd
+    if((cmd = parsecmd(buf)) == 0){
+      areset(&cmdarena);
+      laststatus = 2;
       continue;
     }
-    if(fork1() == 0)
-      runcmd(parsecmd(buf));
-    wait();
+    laststatus = evalcmd(cmd);
+    areset(&cmdarena);
   }
-  
-  exit();
+  histflush();
+  exit(laststatus);
 }
 
 
@@ -313,7 +2013,7 @@ void
 panic(char *s)
 {
   printf(2, "%s\n", s);
-  exit();
+  exit(1);
 }
 
 int
@@ -321,6 +2021,8 @@ fork1(void)
 {
   int pid;
   
+  // Else the child would write out its copy of buffered output too.
+  fflush(stdout);
   pid = fork();
   if(pid == -1)
     panic("fork");
@@ -335,18 +2037,43 @@ execcmd(void)
 {
   struct execcmd *cmd;
 
-  cmd = malloc(sizeof(*cmd));
+  cmd = aalloc(&cmdarena, sizeof(*cmd));
   memset(cmd, 0, sizeof(*cmd));
   cmd->type = EXEC;
+  cmd->size = 8;
+  cmd->argv = aalloc(&cmdarena, cmd->size * sizeof(cmd->argv[0]));
+  cmd->eargv = aalloc(&cmdarena, cmd->size * sizeof(cmd->eargv[0]));
+  cmd->argv[0] = cmd->eargv[0] = 0;
   return (struct cmd*)cmd;
 }
 
+// Append the word from q to eq to cmd's arguments.
+void
+addword(struct execcmd *cmd, char *q, char *eq)
+{
+  char **argv, **eargv;
+
+  if(cmd->argc + 1 >= cmd->size){
+    argv = aalloc(&cmdarena, 2 * cmd->size * sizeof(argv[0]));
+    eargv = aalloc(&cmdarena, 2 * cmd->size * sizeof(eargv[0]));
+    memmove(argv, cmd->argv, cmd->size * sizeof(argv[0]));
+    memmove(eargv, cmd->eargv, cmd->size * sizeof(eargv[0]));
+    cmd->argv = argv;
+    cmd->eargv = eargv;
+    cmd->size *= 2;
+  }
+  cmd->argv[cmd->argc] = q;
+  cmd->eargv[cmd->argc] = eq;
+  cmd->argc++;
+  cmd->argv[cmd->argc] = cmd->eargv[cmd->argc] = 0;
+}
+
 struct cmd*
 redircmd(struct cmd *subcmd, char *file, char *efile, int mode, int fd)
 {
   struct redircmd *cmd;
 
-  cmd = malloc(sizeof(*cmd));
+  cmd = aalloc(&cmdarena, sizeof(*cmd));
   memset(cmd, 0, sizeof(*cmd));
   cmd->type = REDIR;
   cmd->cmd = subcmd;
@@ -362,7 +2089,7 @@ pipecmd(struct cmd *left, struct cmd *right)
 {
   struct pipecmd *cmd;
 
-  cmd = malloc(sizeof(*cmd));
+  cmd = aalloc(&cmdarena, sizeof(*cmd));
   memset(cmd, 0, sizeof(*cmd));
   cmd->type = PIPE;
   cmd->left = left;
@@ -375,7 +2102,7 @@ listcmd(struct cmd *left, struct cmd *right)
 {
   struct listcmd *cmd;
 
-  cmd = malloc(sizeof(*cmd));
+  cmd = aalloc(&cmdarena, sizeof(*cmd));
   memset(cmd, 0, sizeof(*cmd));
   cmd->type = LIST;
   cmd->left = left;
@@ -388,17 +2115,92 @@ backcmd(struct cmd *subcmd)
 {
   struct backcmd *cmd;
 
-  cmd = malloc(sizeof(*cmd));
+  cmd = aalloc(&cmdarena, sizeof(*cmd));
   memset(cmd, 0, sizeof(*cmd));
   cmd->type = BACK;
   cmd->cmd = subcmd;
   return (struct cmd*)cmd;
 }
+
+struct cmd*
+subshellcmd(struct cmd *subcmd)
+{
+  struct cmd *cmd;
+
+  cmd = backcmd(subcmd);
+  cmd->type = SUBSHELL;
+  return cmd;
+}
+
+struct cmd*
+andorcmd(int type, struct cmd *left, struct cmd *right)
+{
+  struct cmd *cmd;
+
+  cmd = listcmd(left, right);
+  cmd->type = type;
+  return cmd;
+}
+
+struct cmd*
+ifcmd(struct cmd *cond, struct cmd *then, struct cmd *els)
+{
+  struct ifcmd *cmd;
+
+  cmd = aalloc(&cmdarena, sizeof(*cmd));
+  memset(cmd, 0, sizeof(*cmd));
+  cmd->type = IF;
+  cmd->cond = cond;
+  cmd->then = then;
+  cmd->els = els;
+  return (struct cmd*)cmd;
+}
+
+struct cmd*
+whilecmd(struct cmd *cond, struct cmd *body)
+{
+  struct whilecmd *cmd;
+
+  cmd = aalloc(&cmdarena, sizeof(*cmd));
+  memset(cmd, 0, sizeof(*cmd));
+  cmd->type = WHILE;
+  cmd->cond = cond;
+  cmd->body = body;
+  return (struct cmd*)cmd;
+}
+
+struct cmd*
+forcmd(struct execcmd *words, struct cmd *body)
+{
+  struct forcmd *cmd;
+
+  cmd = aalloc(&cmdarena, sizeof(*cmd));
+  memset(cmd, 0, sizeof(*cmd));
+  cmd->type = FOR;
+  cmd->words = words;
+  cmd->body = body;
+  return (struct cmd*)cmd;
+}
+
 //PAGEBREAK!
 // Parsing
 
-char whitespace[] = " \t\r\n\v";
-char symbols[] = "<|>&;()";
+char whitespace[] = " \t\r\v";
+char symbols[] = "<|>&;()\n";
+
+// Skip blanks and comments.  A newline is a token of its own.
+char*
+skipspace(char *s, char *es)
+{
+  for(;;){
+    while(s < es && strchr(whitespace, *s))
+      s++;
+    if(s >= es || *s != '#')
+      return s;
+    while(s < es && *s != '\n')
+      s++;
+  }
+}
 
 
 int
@@ -407,23 +2209,31 @@ gettoken(char **ps, char *es, char **q, char **eq)
   char *s;
   int ret;
   
-  s = *ps;
-  while(s < es && strchr(whitespace, *s))
-    s++;
+  s = skipspace(*ps, es);
   if(q)
     *q = s;
   ret = *s;
   switch(*s){
   case 0:
     break;
-  case '|':
   case '(':
   case ')':
   case ';':
-  case '&':
   case '<':
     s++;
     break;
+  case '&':
+  case '|':
+    s++;
+    if(*s == ret){
+      ret = ret == '&' ? 'A' : 'O';  // && or ||
+      s++;
+    }
+    break;
+  case '\n':
+    ret = ';';
+    s++;
+    break;
   case '>':
     s++;
     if(*s == '>'){
@@ -462,9 +2272,7 @@ gettoken(char **ps, char *es, char **q, char **eq)
   if(eq)
     *eq = s;
   
-  while(s < es && strchr(whitespace, *s))
-    s++;
-  *ps = s;
+  *ps = skipspace(s, es);
   return ret;
 }
 
@@ -473,48 +2281,151 @@ peek(char **ps, char *es, char *toks)
 {
   char *s;
   
-  s = *ps;
-  while(s < es && strchr(whitespace, *s))
-    s++;
+  s = skipspace(*ps, es);
   *ps = s;
+  if(*s == '\n' && strchr(toks, ';'))
+    return 1;
   return *s && strchr(toks, *s);
 }
 
+// Is the next token the two-character operator op?
+int
+peekop(char **ps, char *es, char *op)
+{
+  char *s;
+
+  s = skipspace(*ps, es);
+  *ps = s;
+  return s+1 < es && s[0] == op[0] && s[1] == op[1];
+}
+
+// Is the next token the reserved word w?  Reserved words
+// are only recognized where a command could start.
+int
+peekword(char **ps, char *es, char *w)
+{
+  char *s;
+  int n;
+
+  s = skipspace(*ps, es);
+  *ps = s;
+  n = strlen(w);
+  if(es - s < n || !samename(s, w, n))
+    return 0;
+  s += n;
+  return s == es || strchr(whitespace, *s) || strchr(symbols, *s);
+}
+
+// Does a reserved word that ends a command list come next?
+int
+peekend(char **ps, char *es)
+{
+  return peekword(ps, es, "then") || peekword(ps, es, "elif") ||
+    peekword(ps, es, "else") || peekword(ps, es, "fi") ||
+    peekword(ps, es, "do") || peekword(ps, es, "done");
+}
+
 struct cmd *parseline(char**, char*);
+struct cmd *parseandor(char**, char*);
 struct cmd *parsepipe(char**, char*);
 struct cmd *parseexec(char**, char*);
 struct cmd *nulterminate(struct cmd*);
 
+// Set by the parser when the command line is malformed.
+// The shell runs in the same process as the parser, so a syntax
+// error must not exit: report the first one and carry on.
+int parseerr;
+
+void
+syntax(char *msg)
+{
+  if(!parseerr)
+    printf(2, "syntax error: %s\n", msg);
+  parseerr = 1;
+}
+
+// Consume reserved word w, which must come next.
+void
+expect(char **ps, char *es, char *w)
+{
+  if(!peekword(ps, es, w)){
+    if(!parseerr)
+      printf(2, "syntax error: expected %s\n", w);
+    parseerr = 1;
+    return;
+  }
+  gettoken(ps, es, 0, 0);
+}
+
+// Parse command line s, returning 0 if it is malformed.
 struct cmd*
 parsecmd(char *s)
 {
   char *es;
   struct cmd *cmd;
 
+  parseerr = 0;
   es = s + strlen(s);
   cmd = parseline(&s, es);
   peek(&s, es, "");
-  if(s != es){
-    printf(2, "leftovers: %s\n", s);
-    panic("syntax");
-  }
+  if(s != es)
+    syntax("unexpected token");
+  if(parseerr)
+    return 0;
   nulterminate(cmd);
   return cmd;
 }
 
 struct cmd*
 parseline(char **ps, char *es)
+{
+  struct cmd *cmd, *c, **tail;
+  struct listcmd *lcmd;
+  int sep;
+
+  // Build the list of ;-, &- or newline-separated commands in a
+  // loop, so that a long script does not recurse once per line.
+  // Blank lines and empty commands are skipped, so that the
+  // status of a script is that of its last real command.
+  // The list ends at ), a reserved word such as "fi", or the end.
+  cmd = 0;
+  tail = &cmd;
+  for(;;){
+    while(peek(ps, es, ";"))
+      gettoken(ps, es, 0, 0);
+    if(*ps >= es || peek(ps, es, ")") || peekend(ps, es))
+      break;
+    c = parseandor(ps, es);
+    sep = 0;
+    while(peek(ps, es, "&") && !peekop(ps, es, "&&")){
+      gettoken(ps, es, 0, 0);
+      c = backcmd(c);
+      sep = 1;
+    }
+    if(*tail){
+      lcmd = (struct listcmd*)listcmd(*tail, c);
+      *tail = (struct cmd*)lcmd;
+      tail = &lcmd->right;
+    } else
+      *tail = c;
+    if(!sep && !peek(ps, es, ";"))
+      break;
+  }
+  return cmd;
+}
+
+struct cmd*
+parseandor(char **ps, char *es)
 {
   struct cmd *cmd;
+  int tok;
 
   cmd = parsepipe(ps, es);
-  while(peek(ps, es, "&")){
-    gettoken(ps, es, 0, 0);
-    cmd = backcmd(cmd);
-  }
-  if(peek(ps, es, ";")){
-    gettoken(ps, es, 0, 0);
-    cmd = listcmd(cmd, parseline(ps, es));
+  while(peekop(ps, es, "&&") || peekop(ps, es, "||")){
+    tok = gettoken(ps, es, 0, 0);
+    while(peek(ps, es, "\n"))
+      gettoken(ps, es, 0, 0);
+    cmd = andorcmd(tok == 'A' ? AND : OR, cmd, parsepipe(ps, es));
   }
   return cmd;
 }
@@ -525,7 +2436,7 @@ parsepipe(char **ps, char *es)
   struct cmd *cmd;
 
   cmd = parseexec(ps, es);
-  if(peek(ps, es, "|")){
+  if(peek(ps, es, "|") && !peekop(ps, es, "||")){
     gettoken(ps, es, 0, 0);
     cmd = pipecmd(cmd, parsepipe(ps, es));
   }
@@ -543,8 +2454,10 @@ parseredirs(struct cmd *cmd, char **ps, char *es)
       break;
     }
     tok = gettoken(ps, es, 0, 0);
-    if(gettoken(ps, es, &q, &eq) != 'a')
-      panic("missing file for redirection");
+    if(gettoken(ps, es, &q, &eq) != 'a'){
+      syntax("missing file for redirection");
+      break;
+    }
     switch(tok){
     case '<':
       cmd = redircmd(cmd, q, eq, O_RDONLY, 0);
@@ -574,44 +2487,112 @@ parseblock(char **ps, char *es)
   if(!peek(ps, es, "("))
     panic("parseblock");
   gettoken(ps, es, 0, 0);
-  cmd = parseline(ps, es);
-  if(!peek(ps, es, ")"))
-    panic("syntax - missing )");
+  cmd = subshellcmd(parseline(ps, es));
+  if(!peek(ps, es, ")")){
+    syntax("missing )");
+    return cmd;
+  }
   gettoken(ps, es, 0, 0);
   cmd = parseredirs(cmd, ps, es);
   return cmd;
 }
 
+// if list then list [elif list then list]... [else list] fi
+struct cmd*
+parseif(char **ps, char *es)
+{
+  struct cmd *cond, *then, *els;
+
+  gettoken(ps, es, 0, 0);  // if or elif
+  cond = parseline(ps, es);
+  expect(ps, es, "then");
+  then = parseline(ps, es);
+  if(peekword(ps, es, "elif"))
+    return ifcmd(cond, then, parseif(ps, es));
+  els = 0;
+  if(peekword(ps, es, "else")){
+    gettoken(ps, es, 0, 0);
+    els = parseline(ps, es);
+  }
+  expect(ps, es, "fi");
+  return parseredirs(ifcmd(cond, then, els), ps, es);
+}
+
+// while list do list done
+struct cmd*
+parsewhile(char **ps, char *es)
+{
+  struct cmd *cond, *body;
+
+  gettoken(ps, es, 0, 0);
+  cond = parseline(ps, es);
+  expect(ps, es, "do");
+  body = parseline(ps, es);
+  expect(ps, es, "done");
+  return parseredirs(whilecmd(cond, body), ps, es);
+}
+
+// for name in word... do list done
+struct cmd*
+parsefor(char **ps, char *es)
+{
+  struct execcmd *words;
+  struct cmd *body;
+  char *q, *eq;
+
+  gettoken(ps, es, 0, 0);
+  words = (struct execcmd*)execcmd();
+  if(gettoken(ps, es, &q, &eq) != 'a')
+    syntax("missing for variable");
+  else
+    addword(words, q, eq);
+  expect(ps, es, "in");
+  while(!parseerr && !peek(ps, es, "|)&;\n")){
+    if(gettoken(ps, es, &q, &eq) != 'a'){
+      syntax("unexpected token");
+      break;
+    }
+    addword(words, q, eq);
+  }
+  while(peek(ps, es, ";"))
+    gettoken(ps, es, 0, 0);
+  expect(ps, es, "do");
+  body = parseline(ps, es);
+  expect(ps, es, "done");
+  return parseredirs(forcmd(words, body), ps, es);
+}
+
 struct cmd*
 parseexec(char **ps, char *es)
 {
   char *q, *eq;
-  int tok, argc;
+  int tok;
   struct execcmd *cmd;
   struct cmd *ret;
   
   if(peek(ps, es, "("))
     return parseblock(ps, es);
+  if(peekword(ps, es, "if"))
+    return parseif(ps, es);
+  if(peekword(ps, es, "while"))
+    return parsewhile(ps, es);
+  if(peekword(ps, es, "for"))
+    return parsefor(ps, es);
 
   ret = execcmd();
   cmd = (struct execcmd*)ret;
 
-  argc = 0;
   ret = parseredirs(ret, ps, es);
-  while(!peek(ps, es, "|)&;")){
+  while(!peek(ps, es, "|)&;\n")){
     if((tok=gettoken(ps, es, &q, &eq)) == 0)
       break;
-    if(tok != 'a')
-      panic("syntax!");
-    cmd->argv[argc] = q;
-    cmd->eargv[argc] = eq;
-    argc++;
-    if(argc >= MAXARGS)
-      panic("too many args");
+    if(tok != 'a'){
+      syntax("unexpected token");
+      break;
+    }
+    addword(cmd, q, eq);
     ret = parseredirs(ret, ps, es);
   }
-  cmd->argv[argc] = 0;
-  cmd->eargv[argc] = 0;
   return ret;
 }
 
@@ -625,6 +2606,9 @@ nulterminate(struct cmd *cmd)
   struct listcmd *lcmd;
   struct pipecmd *pcmd;
   struct redircmd *rcmd;
+  struct ifcmd *icmd;
+  struct whilecmd *wcmd;
+  struct forcmd *fcmd;
 
   if(cmd == 0)
     return 0;
@@ -643,18 +2627,44 @@ nulterminate(struct cmd *cmd)
     break;
 
   case PIPE:
+  case AND:
+  case OR:
     pcmd = (struct pipecmd*)cmd;
     nulterminate(pcmd->left);
     nulterminate(pcmd->right);
     break;
-    
+
+  case IF:
+    icmd = (struct ifcmd*)cmd;
+    nulterminate(icmd->cond);
+    nulterminate(icmd->then);
+    nulterminate(icmd->els);
+    break;
+
+  case WHILE:
+    wcmd = (struct whilecmd*)cmd;
+    nulterminate(wcmd->cond);
+    nulterminate(wcmd->body);
+    break;
+
+  case FOR:
+    fcmd = (struct forcmd*)cmd;
+    nulterminate((struct cmd*)fcmd->words);
+    nulterminate(fcmd->body);
+    break;
+
   case LIST:
-    lcmd = (struct listcmd*)cmd;
-    nulterminate(lcmd->left);
-    nulterminate(lcmd->right);
+    for(lcmd = (struct listcmd*)cmd; ; lcmd = (struct listcmd*)lcmd->right){
+      nulterminate(lcmd->left);
+      if(lcmd->right == 0 || lcmd->right->type != LIST){
+        nulterminate(lcmd->right);
+        break;
+      }
+    }
     break;
 
   case BACK:
+  case SUBSHELL:
     bcmd = (struct backcmd*)cmd;
     nulterminate(bcmd->cmd);
     break;
@@ -662,307 +2672,267 @@ nulterminate(struct cmd *cmd)
   return cmd;
 }
 
-void initHistory(struct history* hs){
-  hs->length = 1;
-  hs->curcmd = 0;
-  hs->lastcmd = 0;
-}
+// Add cmd, less any trailing newline, as the newest command.
+void
+histadd(char *cmd)
+{
+  char **slot;
+  int n;
 
-void addHistory(struct history* hs, char* cmd){
-  if (cmd[0] == '\n')
+  if((n = strlen(cmd)) > 0 && cmd[n-1] == '\n')
+    n--;
+  if(n == 0 || hist.size == 0)
     return;
-  int l = strlen(cmd);
-  int last = hs->lastcmd;
-  strcpy(hs->record[last], cmd);
-  if (hs->record[last][l - 1] == '\n')
-    hs->record[last][l - 1] = '\0';
-  last = (last + 1) % H_NUMBER;
-  hs->record[last][0] = '\0';
-  hs->lastcmd = last;
-  hs->curcmd = last;
-  if (hs->length < H_NUMBER)
-    hs->length++;
-}
-
-void getHistory(struct history* hs){ 
-  const int bufSize = 128;
-  int fp = open("/.history", O_RDONLY | O_CREATE);
-  int i, length, pos;
-
-  char buf[bufSize];
-  char tmp[bufSize];
-
-  pos = 0;
-  initHistory(hs);
-  while ((length = read(fp, buf, bufSize)) > 0){
-    for (i = 0; i < length; ++i){
-      if (buf[i] == '\n'){
-        tmp[pos] = '\0';
-        addHistory(hs, tmp);
-        pos = 0;
-      }
-      else{
-        tmp[pos++] = buf[i];
-      }
-    }
-  }
-
-  close(fp);
+  slot = &hist.win[hist.n % hist.size];
+  if(*slot)
+    free(*slot);
+  *slot = malloc(n+1);
+  memmove(*slot, cmd, n);
+  (*slot)[n] = 0;
+  histpush(*slot);
+  hist.n++;
+  if(hist.n - hist.ondisk >= HISTBATCH)
+    histflush();
 }
 
-void setHistory(char* cmd){
-    int fp = open("/.history", O_WRONLY | O_CREATE | O_ADD);
-    write(fp, cmd, strlen(cmd));
-    close(fp);
+// Return command i, 0 <= i < hist.n, reading it back from the log
+// if it has left the window.  The result is only good until the
+// next call.
+char*
+histget(int i)
+{
+  struct stat st;
+  uint off[2];
+  int fd, n;
+
+  if(i >= hist.n - hist.size)
+    return hist.win[i % hist.size];
+  if((fd = open(HISTIDX, O_RDONLY)) < 0)
+    return "";
+  lseek(fd, i*sizeof(uint), SEEK_SET);
+  n = read(fd, off, sizeof(off));
+  close(fd);
+  if(n < sizeof(off[0]) || (fd = open(HISTLOG, O_RDONLY)) < 0)
+    return "";
+  if(n < sizeof(off) && fstat(fd, &st) >= 0)
+    off[1] = st.size;
+  if(off[1] <= off[0]){
+    close(fd);
+    return "";
+  }
+  if(hist.old)
+    free(hist.old);
+  hist.old = malloc(off[1] - off[0]);
+  lseek(fd, off[0], SEEK_SET);
+  n = read(fd, hist.old, off[1] - off[0]);
+  close(fd);
+  hist.old[n > 0 ? n-1 : 0] = 0;  // the newline
+  return hist.old;
 }
 
-/*
-void setHistory(struct history* hs){
-  if (!hs || hs->length == 0)
-    return ;
-
-  int fp = open("/.history",O_WRONLY | O_CREATE | O_ADD);  
-  int pos, last;
+// Return the pid held in the history lock, or 0.
+static int
+histholder(void)
+{
+  int fd, pid;
 
-  last = hs->lastcmd;
-  if (hs->length == H_NUMBER){
-    pos = last + 1;
-  }
-  else{
-    pos = 0;
+  pid = 0;
+  if((fd = open(HISTLOCK, O_RDONLY)) >= 0){
+    if(read(fd, &pid, sizeof(pid)) != sizeof(pid))
+      pid = 0;
+    close(fd);
   }
+  return pid;
+}
 
-  while (pos != last){
-    write(fp, hs->record[pos], strlen(hs->record[pos]));
-    write(fp, "\n", 1);
-    pos = (pos + 1) % H_NUMBER;
-  }
+// Remove the history lock if its holder has died, and return 1
+// if it was removed.  Breakers take turns under HISTBREAK, so two
+// of them cannot both see the dead holder and one then remove the
+// lock that the other has just taken.
+static int
+histbreak(void)
+{
+  int pid, broke;
 
-  close(fp);
+  if(mkdir(HISTBREAK) < 0)
+    return 0;
+  broke = 0;
+  if((pid = histholder()) > 0 && kill(pid, 0) < 0)
+    broke = unlink(HISTLOCK) == 0;
+  unlink(HISTBREAK);
+  return broke;
 }
-*/
 
-//input = filename
-//pattern = char[] contains wildcards
-//0 = no match
-//1 = match
-//When pattern is "" will return a match
+// Take the history lock, and return 1 if we got it.  The lock is
+// a file holding its holder's pid, written under a name of our own
+// and then linked to HISTLOCK: link fails if the name exists, and
+// does the check and the create atomically.  A lock whose holder
+// has died is broken; one whose holder lives is waited for for
+// half a second or so, and then we go without it.
 int
-matchesPattern( char* input, char* pattern)
+histlock(void)
 {
-  int i, z;
-  if(pattern[0] == '\0')
-    return 1;
-    
-  for(i = 0; pattern[i] != '\0'; i++)
-  {
-    if(pattern[i] == '\0')
-    {
-      return 0; //Pattern has ended but still some left, meaning no match
-    }
-        
-    else if(pattern[i] == '?')
-    {
-      continue; //? replaces a character, no need to check if there is a match
-    }
-        
-    else if(pattern[i] == '*')
-    {
-      //Pattern has matched up until now, but now need to check
-      //the rest of the pattern
-            
-      //Checking for the match of pattern starting after the *
-      //If the match isn't found, shift input by 1 and check again
-      //If no match is found then pattern doesn't exist
-      for(z = i; input[z] != '\0'; z++)
-      {
-        if(matchesPattern(input + z, pattern + i + 1) == 1)
-        {
-          //Pattern found, return true
-          return 1;
-        }
-      }
-      //If this line was hit the pattern after * couldn't be found anywhere
-      return 0;
-    }
-    else if(pattern[i] == '['){
-        int j;
-        int match = 0;
-        int flag = 0;
-        //find
-        for (j = i+1; ; j++) {
-            if(pattern[j] == ']'){
-                break;
-            }
-            if (pattern[j] == '-') {
-                flag++;
-            }
-        }
-        if(flag >= 2){
-            return 0;//Wrong wildcard format
-        }
-        if(flag == 0){
-            int k;
-            for(k = i+1;k<j;k++){
-                if(pattern[k] == input[i]){
-                    match = 1;
-                }
-            }
-
-        }
-        else{
-            int len = pattern[j-1] - pattern[i+1] +1;
-            int k;
-            char p = pattern[i+1];
-            for(k = 0;k < len;k++){
-                if(p == input[i]){
-                    match = 1;
-                }
-                p++;
-            }
-
-        }
-        if(match >= 1){
-            if(matchesPattern(input+i+1, pattern+j+1) == 1){
-                return 1;
-            }
-            else{
-                return 0;
-            }
-        }
-        else{
-            return 0;
-        }
-        
-    }
-    else if(pattern[i] != input[i])
-    {
-      return 0; //Didn't match input
-    }
-    //Characters matched, keep continuing
+  char tmp[sizeof(HISTLOCK) + 12], *s;
+  int fd, pid, i, got;
+
+  pid = getpid();
+  s = tmp + sizeof(tmp);
+  *--s = 0;
+  i = pid;
+  do
+    *--s = '0' + i % 10;
+  while((i /= 10) > 0);
+  *--s = '.';
+  s -= strlen(HISTLOCK);
+  memmove(s, HISTLOCK, strlen(HISTLOCK));
+
+  if((fd = open(s, O_WRONLY|O_CREATE)) < 0)
+    return 0;
+  got = write(fd, &pid, sizeof(pid)) == sizeof(pid);
+  close(fd);
+  for(i = 0; got && link(s, HISTLOCK) < 0; i++){
+    if(i == 50)
+      got = 0;
+    else if(!histbreak())
+      sleep(1);
   }
-  //To hit here the current pattern must contain no * and must have all characters matching
-  return 1;
+  unlink(s);
+  return got;
 }
 
-char*
-fmtname(char *path)
+// Drop the history lock.  Only for a caller that histlock() let in.
+void
+histunlock(void)
 {
-  static char buf[DIRSIZ+1];
-  char *p;
-  
-  // Find first character after last slash.
-  for(p=path+strlen(path); p >= path && *p != '/'; p--)
-    ;
-  p++;
-  
-  // Return blank-padded name.
-  if(strlen(p) >= DIRSIZ)
-    return p;
-  memmove(buf, p, strlen(p));
-  buf[strlen(p)]=0;//memmove(buf+strlen(p), 0, DIRSIZ-strlen(p));
-  return buf;
+  unlink(HISTLOCK);
 }
 
-void initFilelist(struct fileList * fl){
-  fl->len = 0;
-  int i;
-  for(i = 0;i < FILENUMBER;i++){
-    fl->list[i][0] = '\0';
-  }
-}
+// Append the commands not yet on disk to the log and the index,
+// with one write to each.
+void
+histflush(void)
+{
+  struct stat st;
+  uint *idx, off;
+  char *buf, *s;
+  int lfd, ifd, i, n, len;
 
-void addFilelist(struct fileList *fl,char* filename){
-  if(fl->len >= FILENUMBER)
+  if((n = hist.n - hist.ondisk) == 0)
+    return;
+  if(!histlock()){
+    // Keep them for the next try while the window can hold more.
+    if(n >= hist.size)
+      hist.ondisk = hist.n;
     return;
-  strcpy(fl->list[fl->len],filename);
-  //printf(2,"%d : %s\n",fl->len,fl->list[fl->len]);
-  fl->len++;
+  }
+  len = 0;
+  for(i = hist.ondisk; i < hist.n; i++)
+    len += strlen(hist.win[i % hist.size]) + 1;
+  buf = malloc(len);
+  idx = malloc(n * sizeof(uint));
+  lfd = open(HISTLOG, O_WRONLY|O_CREATE|O_ADD);
+  ifd = open(HISTIDX, O_WRONLY|O_CREATE|O_ADD);
+  // Another shell may have appended since we started,
+  // so take the offsets from the log's size now.
+  if(lfd >= 0 && ifd >= 0 && fstat(lfd, &st) >= 0){
+    off = 0;
+    for(i = 0; i < n; i++){
+      s = hist.win[(hist.ondisk + i) % hist.size];
+      idx[i] = st.size + off;
+      strcpy(buf + off, s);
+      off += strlen(s);
+      buf[off++] = '\n';
+    }
+    if(write(lfd, buf, len) == len)
+      write(ifd, idx, n * sizeof(uint));
+  }
+  if(lfd >= 0)
+    close(lfd);
+  if(ifd >= 0)
+    close(ifd);
+  histunlock();
+  free(buf);
+  free(idx);
+  hist.ondisk = hist.n;
 }
 
-void getFilelist(char *path,struct fileList *fl)
+// Load the newest hist.size commands from the log.  Commands in
+// the log that the index lacks (the index is new, or an append was
+// cut short) are indexed now, which reads the whole log only once.
+void
+histload(void)
 {
-  char buf[512], *p;
-  int fd;
-  struct dirent de;
   struct stat st;
-  if((fd = open(path, 0)) < 0){
-    //printf(2, "ls: cannot open %s\n", path);
-    return;
-  }
-  
-  if(fstat(fd, &st) < 0){
-    //printf(2, "ls: cannot stat %s\n", path);
+  uint off, *idx;
+  char *v, *buf, *p, *e;
+  int fd, n, first, nidx, len, locked;
+
+  v = getvar("HISTSIZE", 8);
+  hist.size = v ? atoi(v) : HISTSIZE;
+  if(hist.size < HISTBATCH)
+    hist.size = HISTBATCH;
+  hist.win = malloc(hist.size * sizeof(hist.win[0]));
+  memset(hist.win, 0, hist.size * sizeof(hist.win[0]));
+
+  // Hold the lock throughout, so that the commands indexed here
+  // are not indexed again by another shell's histflush.  Without
+  // it, load the commands but leave the index alone.
+  locked = histlock();
+  // Offset of the first command in the window.
+  n = first = 0;
+  off = 0;
+  if((fd = open(HISTIDX, O_RDONLY)) >= 0){
+    if(fstat(fd, &st) >= 0)
+      n = st.size / sizeof(uint);
+    first = n > hist.size ? n - hist.size : 0;
+    lseek(fd, first*sizeof(uint), SEEK_SET);
+    if(n > 0 && read(fd, &off, sizeof(off)) != sizeof(off))
+      n = first = off = 0;
     close(fd);
+  }
+  if((fd = open(HISTLOG, O_RDONLY)) < 0 || fstat(fd, &st) < 0){
+    if(fd >= 0)
+      close(fd);
+    if(locked)
+      histunlock();
     return;
   }
-  
-  switch(st.type){
-  case T_FILE:
-    //printf(1, "%s %d %d %d\n", fmtname(path), st.type, st.ino, st.size);
-    //printf(2,"%s\n",fmtname(path));
-    addFilelist(fl,fmtname(path));
-    break;
-  
-  case T_DIR:
-    if(strlen(path) + 1 + DIRSIZ + 1 > sizeof buf){
-      printf(1, "ls: path too long\n");
-      break;
-    }
-    strcpy(buf, path);
-    p = buf+strlen(buf);
-    *p++ = '/';
-    while(read(fd, &de, sizeof(de)) == sizeof(de)){
-      if(de.inum == 0)
-        continue;
-      memmove(p, de.name, DIRSIZ);
-      p[DIRSIZ] = 0;
-      if(stat(buf, &st) < 0){
-        printf(1, "ls: cannot stat %s\n", buf);
-        continue;
-      }
-      //printf(1, "%s %d %d %d\n", fmtname(buf), st.type, st.ino, st.size);
-      //printf(2,"%s\n",fmtname(buf));
-      addFilelist(fl,fmtname(buf));
-    }
-    break;
+  if(off > st.size){  // index is for some other log
+    if(locked)
+      unlink(HISTIDX);
+    n = first = off = 0;
   }
+  len = st.size - off;
+  buf = malloc(len + 1);
+  lseek(fd, off, SEEK_SET);
+  if((len = read(fd, buf, len)) < 0)
+    len = 0;
   close(fd);
-}
-
-void printFilelsit(struct fileList* fl){
-  int i;
-  for(i = 0; i < fl->len;i++){
-    printf(2,"%d File Name: %s\n",i,fl->list[i] );
-  }
-
-}
 
-int checkWildcards(char *str){
-  int i;
-  for(i = 0;str[i] != '\0';i++){
-    if(str[i] == '*' || str[i] == '?'){
-      return 1;
-    }
-    if(str[i] == '['){
-      int j;
-      for(j = i+1;str[j] != '\0';j++){
-        if(str[j] == ']'){
-          return 1;
-        }
-      }
+  idx = malloc((len/2 + 1) * sizeof(uint));  // lines are >= 2 bytes
+  nidx = 0;
+  hist.n = hist.ondisk = first;
+  for(p = e = buf; e < buf + len; e++){
+    if(*e != '\n')
+      continue;
+    if(e > p){
+      if(hist.n >= n)
+        idx[nidx++] = off + (p - buf);
+      *e = 0;
+      histadd(p);
+      hist.ondisk = hist.n;
     }
+    p = e+1;
   }
-  return 0;
-}
-
-void getMatchList(char* filename,struct fileList *allfile,struct fileList *matchfile){
-  int i;
-  int len = allfile->len;
-  for(i = 0;i < len;i++){
-    if(matchesPattern(allfile->list[i],filename)){
-      addFilelist(matchfile,allfile->list[i]);
-    }
+  if(locked && nidx > 0 &&
+     (fd = open(HISTIDX, O_WRONLY|O_CREATE|O_ADD)) >= 0){
+    write(fd, idx, nidx * sizeof(uint));
+    close(fd);
   }
+  if(locked)
+    histunlock();
+  free(idx);
+  free(buf);
 }
 
+
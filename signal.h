@@ -0,0 +1,49 @@
+// Signal numbers, actions and masks.
+
+#define SIGHUP   1   // Hangup
+#define SIGINT   2   // Interrupt from keyboard (^C)
+#define SIGQUIT  3   // Quit
+#define SIGILL   4   // Illegal instruction
+#define SIGTRAP  5   // Breakpoint
+#define SIGABRT  6   // Abort
+#define SIGFPE   8   // Arithmetic exception
+#define SIGKILL  9   // Kill; cannot be caught or blocked
+#define SIGUSR1 10   // User-defined
+#define SIGSEGV 11   // Bad memory reference
+#define SIGUSR2 12   // User-defined
+#define SIGPIPE 13   // Write to pipe with no readers
+#define SIGALRM 14   // Timer
+#define SIGTERM 15   // Termination
+#define SIGCHLD 17   // Child exited; ignored by default
+#define SIGCONT 18   // Continue if stopped; ignored by default
+#define SIGSTOP 19   // Stop; cannot be caught or blocked
+#define SIGTSTP 20   // Stop from keyboard (^Z)
+#define SIGTTIN 21   // Background read from console
+#define SIGTTOU 22   // Background write to console
+#define NSIG    32
+
+#define sigbit(sig)  (1U << (sig))
+
+// Signals whose default action is to stop the process, and
+// those whose default action is to do nothing.  All others
+// terminate it.
+#define SIGSTOPMASK (sigbit(SIGSTOP)|sigbit(SIGTSTP)|sigbit(SIGTTIN)|sigbit(SIGTTOU))
+#define SIGIGNMASK  (sigbit(SIGCHLD)|sigbit(SIGCONT))
+
+typedef void (*sighandler_t)(int);
+
+#define SIG_DFL ((sighandler_t)0)   // Default action
+#define SIG_IGN ((sighandler_t)1)   // Ignore
+#define SIG_ERR ((sighandler_t)-1)  // Returned by signal() on error
+
+struct sigaction {
+  sighandler_t sa_handler;     // SIG_DFL, SIG_IGN or handler
+  uint sa_mask;                // Signals blocked while handler runs
+  void (*sa_restorer)(void);   // Handler returns here; must call
+                               // sigreturn() (signal() uses sigreturn)
+};
+
+// How sigprocmask() changes the blocked mask.
+#define SIG_BLOCK    0
+#define SIG_UNBLOCK  1
+#define SIG_SETMASK  2
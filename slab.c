@@ -0,0 +1,174 @@
+// Slab allocator, for kernel objects smaller than a page
+// (pipes, open files, in-memory inodes, buffers, processes).
+//
+// A slab is one page from kalloc(): a struct slab header followed
+// by as many objects as fit. Free objects in a slab are chained
+// through their first word. A cache lists its slabs that still have
+// free objects; full slabs are not listed, and a slab whose objects
+// are all free goes back to kalloc().
+//
+// In front of the slabs each CPU has a magazine of up to MAGSIZE
+// free objects. kmem_cache_alloc() and kmem_cache_free() only need
+// the cache lock when a magazine runs empty or full, and then they
+// move half a magazine at a time.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "wait.h"
+#include "signal.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "slab.h"
+
+struct slab {
+  struct slab *next;         // on cache's partial list
+  struct slab *prev;
+  uint nfree;                // free objects in this slab
+  void *free;                // first free object
+};
+
+#define SLABHDR ((sizeof(struct slab) + 7) & ~7)
+
+void
+kmem_cache_init(struct kmem_cache *c, char *name, uint size)
+{
+  initlock(&c->lock, name);
+  c->name = name;
+  c->size = (size + 7) & ~7;
+  if(c->size < sizeof(void*) || c->size > PGSIZE - SLABHDR)
+    panic("kmem_cache_init: size");
+  c->perslab = (PGSIZE - SLABHDR) / c->size;
+  c->partial = 0;
+  c->nslab = 0;
+  c->nobj = 0;
+  memset(c->mag, 0, sizeof(c->mag));
+}
+
+static void
+unlinkslab(struct kmem_cache *c, struct slab *s)
+{
+  if(s->prev)
+    s->prev->next = s->next;
+  else
+    c->partial = s->next;
+  if(s->next)
+    s->next->prev = s->prev;
+}
+
+static void
+linkslab(struct kmem_cache *c, struct slab *s)
+{
+  s->prev = 0;
+  s->next = c->partial;
+  if(c->partial)
+    c->partial->prev = s;
+  c->partial = s;
+}
+
+// Allocate and carve up a new slab page.
+// Caller must hold c->lock.
+static struct slab*
+growcache(struct kmem_cache *c)
+{
+  struct slab *s;
+  char *obj;
+  uint i;
+
+  if((s = (struct slab*)kalloc()) == 0)
+    return 0;
+  s->nfree = c->perslab;
+  s->free = 0;
+  for(i = c->perslab; i > 0; i--){
+    obj = (char*)s + SLABHDR + (i-1)*c->size;
+    *(void**)obj = s->free;
+    s->free = obj;
+  }
+  linkslab(c, s);
+  c->nslab++;
+  return s;
+}
+
+// Move up to MAGSIZE/2 objects from the slabs into magazine m.
+static void
+refill(struct kmem_cache *c, struct magazine *m)
+{
+  struct slab *s;
+  void *obj;
+
+  acquire(&c->lock);
+  while(m->n < MAGSIZE/2){
+    if((s = c->partial) == 0 && (s = growcache(c)) == 0)
+      break;
+    obj = s->free;
+    s->free = *(void**)obj;
+    if(--s->nfree == 0)
+      unlinkslab(c, s);
+    m->obj[m->n++] = obj;
+    c->nobj++;
+  }
+  release(&c->lock);
+}
+
+// Move half of magazine m back into the slabs, returning
+// slabs that become completely free to kalloc().
+static void
+drain(struct kmem_cache *c, struct magazine *m)
+{
+  struct slab *s;
+  void *obj;
+
+  acquire(&c->lock);
+  while(m->n > MAGSIZE/2){
+    obj = m->obj[--m->n];
+    s = (struct slab*)PGROUNDDOWN((uint)obj);
+    *(void**)obj = s->free;
+    s->free = obj;
+    if(s->nfree++ == 0)
+      linkslab(c, s);
+    c->nobj--;
+    if(s->nfree == c->perslab){
+      unlinkslab(c, s);
+      c->nslab--;
+      kfree((char*)s);
+    }
+  }
+  release(&c->lock);
+}
+
+// Allocate one zeroed object from cache c.
+// Returns 0 if memory is exhausted.
+void*
+kmem_cache_alloc(struct kmem_cache *c)
+{
+  struct magazine *m;
+  void *obj;
+
+  pushcli();
+  m = &c->mag[cpu - cpus];
+  if(m->n == 0)
+    refill(c, m);
+  obj = m->n > 0 ? m->obj[--m->n] : 0;
+  popcli();
+  if(obj)
+    memset(obj, 0, c->size);
+  return obj;
+}
+
+// Return object obj, which came from kmem_cache_alloc(c).
+void
+kmem_cache_free(struct kmem_cache *c, void *obj)
+{
+  struct magazine *m;
+
+  if(obj == 0 || (uint)obj % 8 != 0)
+    panic("kmem_cache_free");
+  pushcli();
+  m = &c->mag[cpu - cpus];
+  if(m->n == MAGSIZE)
+    drain(c, m);
+  m->obj[m->n++] = obj;
+  popcli();
+}
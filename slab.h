@@ -0,0 +1,22 @@
+// Slab allocator for fixed-size kernel objects.
+// Each cache carves 4096-byte pages from kalloc() into objects
+// of one size and keeps a small magazine of free objects per CPU,
+// so that most allocations and frees touch no shared lock.
+
+#define MAGSIZE 16  // objects per per-CPU magazine
+
+struct magazine {
+  int n;                     // number of objects in obj[]
+  void *obj[MAGSIZE];
+};
+
+struct kmem_cache {
+  struct spinlock lock;      // protects partial, nslab, nobj
+  char *name;                // Name of cache (debugging)
+  uint size;                 // Object size, rounded up to 8 bytes
+  uint perslab;              // Objects per slab page
+  struct slab *partial;      // Slabs with at least one free object
+  uint nslab;                // Slab pages allocated
+  uint nobj;                 // Objects handed out (includes magazines)
+  struct magazine mag[NCPU]; // Per-CPU free objects, indexed by cpu-cpus
+};
@@ -6,6 +6,8 @@
 #include "x86.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "wait.h"
+#include "signal.h"
 #include "proc.h"
 #include "spinlock.h"
 
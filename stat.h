@@ -8,4 +8,5 @@ struct stat {
   uint ino;    // Inode number
   short nlink; // Number of links to file
   uint size;   // Size of file in bytes
+  uint gen;    // Changes whenever the file's data is written
 };
@@ -0,0 +1,200 @@
+// Buffered I/O on file descriptors.
+//
+// A FILE holds up to BUFSIZ bytes on their way to or from its
+// descriptor, so that a line of output, or a whole screenful,
+// costs one write() rather than one per character, and input
+// is read a buffer at a time.  A FILE is used either for
+// reading or for writing, not both.
+//
+// Output is written out when the buffer fills, and also at each
+// newline for a line-buffered FILE (IOLBF) and at the end of each
+// call for an unbuffered one (IONBF).  exit() flushes everything.
+//
+// An unbuffered FILE reads a byte at a time, so that what it has
+// not returned is still there for other processes reading the same
+// descriptor.  stdin is unbuffered when it is not a device: a
+// program that reads a line and then runs another must leave it
+// the rest of a file or pipe.  A console read stops at the end of
+// a line anyway.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+static FILE stdfile[3] = {
+  { 0, IOFBF },
+  { 1, IOLBF },
+  { 2, IONBF },
+};
+
+FILE *stdin = &stdfile[0];
+FILE *stdout = &stdfile[1];
+FILE *stderr = &stdfile[2];
+
+static FILE *opened;  // FILEs from fdopen(), linked through next
+static int stdinset;  // stdin's mode is chosen
+
+static void
+flushall(void)
+{
+  FILE *f;
+
+  fflush(stdout);
+  fflush(stderr);
+  for(f = opened; f; f = f->next)
+    fflush(f);
+}
+
+FILE*
+fdopen(int fd, int mode)
+{
+  FILE *f;
+
+  if((f = malloc(sizeof(*f))) == 0)
+    return 0;
+  memset(f, 0, sizeof(*f));
+  f->fd = fd;
+  f->mode = mode;
+  f->next = opened;
+  opened = f;
+  return f;
+}
+
+int
+fclose(FILE *f)
+{
+  FILE **pp;
+  int r;
+
+  r = fflush(f);
+  if(close(f->fd) < 0)
+    r = -1;
+  for(pp = &opened; *pp; pp = &(*pp)->next){
+    if(*pp == f){
+      *pp = f->next;
+      free(f);
+      break;
+    }
+  }
+  return r;
+}
+
+void
+setvbuf(FILE *f, int mode)
+{
+  fflush(f);
+  f->mode = mode;
+  if(f == stdin)
+    stdinset = 1;
+}
+
+// Write out f's buffered output.
+// Returns 0, or -1 if the write failed; the output is dropped either way.
+int
+fflush(FILE *f)
+{
+  int n;
+
+  if(f->w == 0)
+    return 0;
+  n = write(f->fd, f->buf, f->w);
+  if(n != f->w){
+    f->w = 0;
+    return -1;
+  }
+  f->w = 0;
+  return 0;
+}
+
+// Add c to f's output, writing it out as f's mode asks,
+// except that an unbuffered FILE waits for fdone().
+void
+fbput(FILE *f, int c)
+{
+  exithook = flushall;
+  f->buf[f->w++] = c;
+  if(f->w == BUFSIZ || (c == '\n' && f->mode == IOLBF))
+    fflush(f);
+}
+
+// The end of a call that wrote to f.
+void
+fdone(FILE *f)
+{
+  if(f->mode == IONBF)
+    fflush(f);
+}
+
+int
+fputc(int c, FILE *f)
+{
+  fbput(f, c);
+  fdone(f);
+  return c & 0xff;
+}
+
+int
+fputs(char *s, FILE *f)
+{
+  while(*s)
+    fbput(f, *s++);
+  fdone(f);
+  return 0;
+}
+
+// Return the next byte from f, or EOF.
+int
+fgetc(FILE *f)
+{
+  struct stat st;
+
+  if(f->r == f->n){
+    if(f == stdin){
+      if(!stdinset && (fstat(f->fd, &st) < 0 || st.type != T_DEV))
+        f->mode = IONBF;
+      stdinset = 1;
+      // Show the prompt before waiting for an answer.
+      fflush(stdout);
+    }
+    f->r = 0;
+    if((f->n = read(f->fd, f->buf, f->mode == IONBF ? 1 : BUFSIZ)) <= 0){
+      f->n = 0;
+      return EOF;
+    }
+  }
+  return f->buf[f->r++] & 0xff;
+}
+
+// Read a line, including its newline, into buf.
+// Returns 0 at end of file.
+char*
+fgets(char *buf, int max, FILE *f)
+{
+  int i, c;
+
+  for(i = 0; i+1 < max; ){
+    if((c = fgetc(f)) == EOF)
+      break;
+    buf[i++] = c;
+    if(c == '\n')
+      break;
+  }
+  buf[i] = '\0';
+  return i > 0 ? buf : 0;
+}
+
+char*
+gets(char *buf, int max)
+{
+  int i, c;
+
+  for(i=0; i+1 < max; ){
+    if((c = fgetc(stdin)) == EOF)
+      break;
+    buf[i++] = c;
+    if(c == '\n' || c == '\r')
+      break;
+  }
+  buf[i] = '\0';
+  return buf;
+}
@@ -3,6 +3,8 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "wait.h"
+#include "signal.h"
 #include "proc.h"
 #include "x86.h"
 #include "syscall.h"
@@ -99,7 +101,24 @@ extern int sys_wait(void);
 extern int sys_write(void);
 extern int sys_uptime(void);
 
-extern int sys_passHistory(void);
+extern int sys_histpush(void);
+extern int sys_yield(void);
+extern int sys_cpustat(void);
+extern int sys_wait4(void);
+extern int sys_setpgid(void);
+extern int sys_getpgid(void);
+extern int sys_killpg(void);
+extern int sys_tcsetpgrp(void);
+extern int sys_tcgetpgrp(void);
+extern int sys_sigaction(void);
+extern int sys_sigprocmask(void);
+extern int sys_sigreturn(void);
+extern int sys_lookpath(void);
+extern int sys_hashstat(void);
+extern int sys_rehash(void);
+extern int sys_execve(void);
+extern int sys_lseek(void);
+extern int sys_complete(void);
 
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -124,7 +143,24 @@ static int (*syscalls[])(void) = {
 [SYS_mkdir]   sys_mkdir,
 [SYS_close]   sys_close,
 
-[SYS_passHistory] sys_passHistory,
+[SYS_histpush] sys_histpush,
+[SYS_yield]   sys_yield,
+[SYS_cpustat] sys_cpustat,
+[SYS_wait4]   sys_wait4,
+[SYS_setpgid] sys_setpgid,
+[SYS_getpgid] sys_getpgid,
+[SYS_killpg]  sys_killpg,
+[SYS_tcsetpgrp] sys_tcsetpgrp,
+[SYS_tcgetpgrp] sys_tcgetpgrp,
+[SYS_sigaction] sys_sigaction,
+[SYS_sigprocmask] sys_sigprocmask,
+[SYS_sigreturn] sys_sigreturn,
+[SYS_lookpath] sys_lookpath,
+[SYS_hashstat] sys_hashstat,
+[SYS_rehash]  sys_rehash,
+[SYS_execve]  sys_execve,
+[SYS_lseek]   sys_lseek,
+[SYS_complete] sys_complete,
 };
 
 void
@@ -21,4 +21,21 @@
 #define SYS_mkdir  20
 #define SYS_close  21
 
-#define SYS_passHistory 22
+#define SYS_histpush 22
+#define SYS_yield  23
+#define SYS_cpustat 24
+#define SYS_wait4  25
+#define SYS_setpgid 26
+#define SYS_getpgid 27
+#define SYS_killpg 28
+#define SYS_tcsetpgrp 29
+#define SYS_tcgetpgrp 30
+#define SYS_sigaction 31
+#define SYS_sigprocmask 32
+#define SYS_sigreturn 33
+#define SYS_lookpath 34
+#define SYS_hashstat 35
+#define SYS_rehash 36
+#define SYS_execve 37
+#define SYS_lseek  38
+#define SYS_complete 39
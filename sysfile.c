@@ -9,31 +9,13 @@
 #include "param.h"
 #include "stat.h"
 #include "mmu.h"
+#include "wait.h"
+#include "signal.h"
 #include "proc.h"
 #include "fs.h"
 #include "file.h"
 #include "fcntl.h"
-
-#include "history.h"
-#include "var_in_kernel.h"
-
-
-int sys_passHistory(void){
-  struct history *p = 0;
-  char *str = (char *)p;
-  argptr(0,&str,sizeof(struct history));
-  p = (struct history *)str;
-  memset(&hs,0,sizeof(struct history));
-  hs.length = p->length;
-  hs.curcmd = p->curcmd;
-  hs.lastcmd = p->lastcmd;
-  int i;
-  for(i = 0; i < hs.length;i++){
-    strncpy(hs.record[i],p->record[i],strlen(p->record[i]));
-  }
-  return 0;
-}
-
+#include "exechash.h"
 
 // Fetch the nth word-sized system call argument as a file descriptor
 // and return both the descriptor and the corresponding struct file.
@@ -96,6 +78,17 @@ sys_read(void)
   return fileread(f, p, n);
 }
 
+int
+sys_lseek(void)
+{
+  struct file *f;
+  int off, whence;
+
+  if(argfd(0, 0, &f) < 0 || argint(1, &off) < 0 || argint(2, &whence) < 0)
+    return -1;
+  return fileseek(f, off, whence);
+}
+
 int
 sys_write(void)
 {
@@ -245,6 +238,7 @@ sys_unlink(void)
   ip->nlink--;
   iupdate(ip);
   iunlockput(ip);
+  execforget(name);
 
   end_op();
 
@@ -420,30 +414,107 @@ sys_chdir(void)
   return 0;
 }
 
-int
-sys_exec(void)
+// Fetch the nth system call argument as a null-terminated
+// array of at most MAXARG strings.
+static int
+argstrv(int n, char **v)
 {
-  char *path, *argv[MAXARG];
   int i;
-  uint uargv, uarg;
+  uint uv, u;
 
-  if(argstr(0, &path) < 0 || argint(1, (int*)&uargv) < 0){
+  if(argint(n, (int*)&uv) < 0)
     return -1;
-  }
-  memset(argv, 0, sizeof(argv));
   for(i=0;; i++){
-    if(i >= NELEM(argv))
+    if(i > MAXARG)
       return -1;
-    if(fetchint(uargv+4*i, (int*)&uarg) < 0)
+    if(fetchint(uv+4*i, (int*)&u) < 0)
       return -1;
-    if(uarg == 0){
-      argv[i] = 0;
-      break;
+    if(u == 0){
+      v[i] = 0;
+      return 0;
     }
-    if(fetchstr(uarg, &argv[i]) < 0)
+    if(fetchstr(u, &v[i]) < 0)
       return -1;
   }
-  return exec(path, argv);
+}
+
+// The argv and envp pointer arrays are too big for the kernel
+// stack, so they share a page from kalloc().
+int
+sys_exec(void)
+{
+  char *path, **argv;
+  int r;
+
+  if(argstr(0, &path) < 0 || (argv = (char**)kalloc()) == 0)
+    return -1;
+  r = -1;
+  if(argstrv(1, argv) >= 0)
+    r = exec(path, argv, 0);
+  kfree((char*)argv);
+  return r;
+}
+
+int
+sys_execve(void)
+{
+  char *path, **argv, **envp;
+  int r;
+
+  if(argstr(0, &path) < 0 || (argv = (char**)kalloc()) == 0)
+    return -1;
+  envp = argv + MAXARG+1;
+  r = -1;
+  if(argstrv(1, argv) >= 0 && argstrv(2, envp) >= 0)
+    r = exec(path, argv, envp);
+  kfree((char*)argv);
+  return r;
+}
+
+// Find the file exec would run for a command name.
+int
+sys_lookpath(void)
+{
+  char *name, *buf, found[HASHPATH];
+  struct inode *ip;
+  int n;
+
+  if(argstr(0, &name) < 0 || argint(2, &n) < 0 || argptr(1, &buf, n) < 0)
+    return -1;
+  begin_op();
+  ip = execlookup(name, found);
+  if(ip)
+    iput(ip);
+  end_op();
+  if(ip == 0 || n <= 0)
+    return -1;
+  safestrcpy(buf, found, n);
+  return 0;
+}
+
+int
+sys_hashstat(void)
+{
+  struct hashent *h;
+  int n;
+
+  if(argint(1, &n) < 0 || n < 0)
+    return -1;
+  // Cap n first, so that n*sizeof(*h) cannot wrap around.
+  if(n > NEXECCACHE)
+    n = NEXECCACHE;
+  if(argptr(0, (void*)&h, n*sizeof(*h)) < 0)
+    return -1;
+  return hashstat(h, n);
+}
+
+int
+sys_rehash(void)
+{
+  begin_op();
+  rehash();
+  end_op();
+  return 0;
 }
 
 int
@@ -470,5 +541,50 @@ sys_pipe(void)
   return 0;
 }
 
+int
+sys_tcsetpgrp(void)
+{
+  int pgid;
+
+  if(argint(0, &pgid) < 0)
+    return -1;
+  return consolesetpgrp(pgid);
+}
+
+int
+sys_tcgetpgrp(void)
+{
+  return consolegetpgrp();
+}
 
+// Add a command to the console's history; 0 starts a new session.
+int
+sys_histpush(void)
+{
+  char *cmd;
+  int addr;
 
+  if(argint(0, &addr) < 0)
+    return -1;
+  if(addr == 0){
+    consolehistadd(0);
+    return 0;
+  }
+  if(argstr(0, &cmd) < 0)
+    return -1;
+  consolehistadd(cmd);
+  return 0;
+}
+
+// Insert s into the line being typed on the console: the
+// shell's answer to a completion request.
+int
+sys_complete(void)
+{
+  char *s;
+
+  if(argstr(0, &s) < 0)
+    return -1;
+  consolecomplete(s);
+  return 0;
+}
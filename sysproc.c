@@ -5,6 +5,8 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "wait.h"
+#include "signal.h"
 #include "proc.h"
 
 int
@@ -16,7 +18,11 @@ sys_fork(void)
 int
 sys_exit(void)
 {
-  exit();
+  int n;
+
+  if(argint(0, &n) < 0)
+    n = 0;
+  exit((n & 0xff) << 8);
   return 0;  // not reached
 }
 
@@ -26,14 +32,29 @@ sys_wait(void)
   return wait();
 }
 
+int
+sys_wait4(void)
+{
+  int pid, options, status, ru;
+
+  if(argint(0, &pid) < 0 || argint(1, &status) < 0 ||
+     argint(2, &options) < 0 || argint(3, &ru) < 0)
+    return -1;
+  if(status && argptr(1, (char**)&status, sizeof(int)) < 0)
+    return -1;
+  if(ru && argptr(3, (char**)&ru, sizeof(struct rusage)) < 0)
+    return -1;
+  return wait4(pid, (int*)status, options, (struct rusage*)ru);
+}
+
 int
 sys_kill(void)
 {
-  int pid;
+  int pid, sig;
 
-  if(argint(0, &pid) < 0)
+  if(argint(0, &pid) < 0 || argint(1, &sig) < 0)
     return -1;
-  return kill(pid);
+  return kill(pid, sig);
 }
 
 int
@@ -67,7 +88,7 @@ sys_sleep(void)
   acquire(&tickslock);
   ticks0 = ticks;
   while(ticks - ticks0 < n){
-    if(proc->killed){
+    if(issig()){
       release(&tickslock);
       return -1;
     }
@@ -89,3 +110,88 @@ sys_uptime(void)
   release(&tickslock);
   return xticks;
 }
+
+int
+sys_yield(void)
+{
+  yield();
+  return 0;
+}
+
+// Report the number of context switches and TLB flushes
+// (%cr3 loads) summed over all CPUs since boot.
+int
+sys_cpustat(void)
+{
+  uint *nswitch, *ntlbflush;
+
+  if(argptr(0, (void*)&nswitch, sizeof(*nswitch)) < 0 ||
+     argptr(1, (void*)&ntlbflush, sizeof(*ntlbflush)) < 0)
+    return -1;
+  cpustat(nswitch, ntlbflush);
+  return 0;
+}
+
+int
+sys_setpgid(void)
+{
+  int pid, pgid;
+
+  if(argint(0, &pid) < 0 || argint(1, &pgid) < 0)
+    return -1;
+  return setpgid(pid, pgid);
+}
+
+int
+sys_getpgid(void)
+{
+  int pid;
+
+  if(argint(0, &pid) < 0)
+    return -1;
+  return getpgid(pid);
+}
+
+int
+sys_killpg(void)
+{
+  int pgid, sig;
+
+  if(argint(0, &pgid) < 0 || argint(1, &sig) < 0)
+    return -1;
+  return killpg(pgid, sig);
+}
+
+int
+sys_sigaction(void)
+{
+  int sig, act, oact;
+
+  if(argint(0, &sig) < 0 || argint(1, &act) < 0 || argint(2, &oact) < 0)
+    return -1;
+  if(act && argptr(1, (char**)&act, sizeof(struct sigaction)) < 0)
+    return -1;
+  if(oact && argptr(2, (char**)&oact, sizeof(struct sigaction)) < 0)
+    return -1;
+  return sigaction(sig, (struct sigaction*)act, (struct sigaction*)oact);
+}
+
+int
+sys_sigprocmask(void)
+{
+  int how, set, oset;
+
+  if(argint(0, &how) < 0 || argint(1, &set) < 0 || argint(2, &oset) < 0)
+    return -1;
+  if(set && argptr(1, (char**)&set, sizeof(uint)) < 0)
+    return -1;
+  if(oset && argptr(2, (char**)&oset, sizeof(uint)) < 0)
+    return -1;
+  return sigprocmask(how, (uint*)set, (uint*)oset);
+}
+
+int
+sys_sigreturn(void)
+{
+  return sigreturn();
+}
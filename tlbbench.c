@@ -0,0 +1,77 @@
+// Microbenchmark for kernel paths that are sensitive to page-table
+// size and TLB reach: building and tearing down address spaces
+// (fork/exit/wait), the kernel touching many distinct physical
+// pages through its direct map (growing and shrinking the heap),
+// and context switches back into the same process (yield).
+// Prints elapsed clock ticks for each phase.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+#define NFORK   200
+#define NSBRK   50
+#define SBRKSZ  (4*1024*1024)
+#define NYIELD  10000
+
+void
+forkbench(void)
+{
+  int i, pid, t0;
+
+  t0 = uptime();
+  for(i = 0; i < NFORK; i++){
+    pid = fork();
+    if(pid < 0){
+      printf(1, "tlbbench: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0)
+      exit(0);
+    wait();
+  }
+  printf(1, "fork+exit+wait x%d: %d ticks\n", NFORK, uptime() - t0);
+}
+
+void
+sbrkbench(void)
+{
+  int i, t0;
+  char *a;
+
+  t0 = uptime();
+  for(i = 0; i < NSBRK; i++){
+    if((a = sbrk(SBRKSZ)) == (char*)-1){
+      printf(1, "tlbbench: sbrk failed\n");
+      exit(1);
+    }
+    a[0] = a[SBRKSZ-1] = 1;
+    sbrk(-SBRKSZ);
+  }
+  printf(1, "sbrk +/-%d bytes x%d: %d ticks\n", SBRKSZ, NSBRK, uptime() - t0);
+}
+
+void
+yieldbench(void)
+{
+  int i, t0;
+  uint sw0, fl0, sw1, fl1;
+
+  cpustat(&sw0, &fl0);
+  t0 = uptime();
+  for(i = 0; i < NYIELD; i++)
+    yield();
+  cpustat(&sw1, &fl1);
+  printf(1, "yield x%d: %d ticks, %d switches, %d tlb flushes\n",
+         NYIELD, uptime() - t0, sw1 - sw0, fl1 - fl0);
+}
+
+int
+main(void)
+{
+  printf(1, "tlbbench starting\n");
+  forkbench();
+  sbrkbench();
+  yieldbench();
+  exit(0);
+}
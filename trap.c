@@ -3,6 +3,8 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "wait.h"
+#include "signal.h"
 #include "proc.h"
 #include "x86.h"
 #include "traps.h"
@@ -32,22 +34,119 @@ idtinit(void)
   lidt(idt, sizeof(idt));
 }
 
+// Frame pushed on the user stack to run a signal handler.
+// The handler is entered as if called with argument sig from
+// address ret; returning there runs sa_restorer, which calls
+// sigreturn() with esp pointing at sig.
+struct sigframe {
+  uint ret;                // sa_restorer
+  int sig;                 // Handler's argument
+  uint mask;               // Blocked signals to restore
+  struct trapframe tf;     // User registers to restore
+};
+
+// Arrange for the current process to run the handler for sig
+// when it returns to user space with registers tf.
+static int
+sendsig(struct trapframe *tf, int sig)
+{
+  struct sigaction *sa;
+  struct sigframe f;
+  uint sp, mask;
+
+  sa = &proc->sigact[sig];
+  f.ret = (uint)sa->sa_restorer;
+  f.sig = sig;
+  f.mask = proc->sigblocked;
+  f.tf = *tf;
+  sp = (tf->esp - sizeof(f)) & ~3;
+  if(sp >= tf->esp || copyout(proc->pgdir, sp, &f, sizeof(f)) < 0)
+    return -1;
+  mask = sa->sa_mask | sigbit(sig);
+  sigprocmask(SIG_BLOCK, &mask, 0);
+  tf->esp = sp;
+  tf->eip = (uint)sa->sa_handler;
+  return 0;
+}
+
+// Return from a signal handler: restore the user registers and
+// blocked mask saved by sendsig.  Returns the restored %eax,
+// which syscall() puts back in place.
+int
+sigreturn(void)
+{
+  struct trapframe *tf;
+  struct sigframe *f;
+  uint flags;
+
+  tf = proc->tf;
+  f = (struct sigframe*)(tf->esp - 4);
+  if(tf->esp < 4 || (uint)f >= proc->sz || (uint)f + sizeof(*f) > proc->sz)
+    exit(SIGSEGV);
+  sigprocmask(SIG_SETMASK, &f->mask, 0);
+  tf->edi = f->tf.edi;
+  tf->esi = f->tf.esi;
+  tf->ebp = f->tf.ebp;
+  tf->ebx = f->tf.ebx;
+  tf->edx = f->tf.edx;
+  tf->ecx = f->tf.ecx;
+  tf->eip = f->tf.eip;
+  tf->esp = f->tf.esp;
+  // Only let the user restore arithmetic and direction flags.
+  flags = FL_CF|FL_PF|FL_AF|FL_ZF|FL_SF|FL_DF|FL_OF;
+  tf->eflags = (tf->eflags & ~flags) | (f->tf.eflags & flags);
+  return f->tf.eax;
+}
+
+// Act on the current process's stops, death and pending signals
+// before it returns to user space with registers tf.
+// Runs at most one handler; the rest wait for its sigreturn().
+static void
+usersig(struct trapframe *tf)
+{
+  sighandler_t h;
+  int sig;
+
+  for(;;){
+    if(proc->stopped)
+      checkstop();
+    if(proc->killed)
+      exit(proc->killed);
+    if((sig = nextsig()) == 0)
+      return;
+    h = proc->sigact[sig].sa_handler;
+    if(h == SIG_IGN)
+      continue;
+    if(h == SIG_DFL){
+      if(sigbit(sig) & SIGSTOPMASK)
+        stopself(sig);
+      else if(!(sigbit(sig) & SIGIGNMASK))
+        exit(sig);
+      continue;
+    }
+    if(sendsig(tf, sig) < 0)
+      exit(SIGSEGV);
+    return;
+  }
+}
+
 //PAGEBREAK: 41
 void
 trap(struct trapframe *tf)
 {
   if(tf->trapno == T_SYSCALL){
     if(proc->killed)
-      exit();
+      exit(proc->killed);
     proc->tf = tf;
     syscall();
-    if(proc->killed)
-      exit();
+    usersig(tf);
     return;
   }
 
   switch(tf->trapno){
   case T_IRQ0 + IRQ_TIMER:
+    if(proc && proc->state == RUNNING)
+      proc->ru.ticks++;
     if(cpu->id == 0){
       acquire(&tickslock);
       ticks++;
@@ -87,25 +186,33 @@ trap(struct trapframe *tf)
       panic("trap");
     }
     // In user space, assume process misbehaved.
+    if(tf->trapno == T_PGFLT)
+      proc->ru.pgfault++;
     cprintf("pid %d %s: trap %d err %d on cpu %d "
             "eip 0x%x addr 0x%x--kill proc\n",
             proc->pid, proc->name, tf->trapno, tf->err, cpu->id, tf->eip, 
             rcr2());
-    proc->killed = 1;
+    if(tf->trapno == T_DIVIDE)
+      proc->killed = SIGFPE;
+    else if(tf->trapno == T_ILLOP)
+      proc->killed = SIGILL;
+    else
+      proc->killed = SIGSEGV;
   }
 
   // Force process exit if it has been killed and is in user space.
   // (If it is still executing in the kernel, let it keep running 
   // until it gets to the regular system call return.)
   if(proc && proc->killed && (tf->cs&3) == DPL_USER)
-    exit();
+    exit(proc->killed);
 
   // Force process to give up CPU on clock tick.
   // If interrupts were on while locks held, would need to check nlock.
   if(proc && proc->state == RUNNING && tf->trapno == T_IRQ0+IRQ_TIMER)
     yield();
 
-  // Check if the process has been killed since we yielded
-  if(proc && proc->killed && (tf->cs&3) == DPL_USER)
-    exit();
+  // Check if the process has been stopped, killed or signalled
+  // since we yielded.
+  if(proc && (tf->cs&3) == DPL_USER)
+    usersig(tf);
 }
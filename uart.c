@@ -1,4 +1,10 @@
 // Intel 8250 serial port (UART).
+//
+// Output goes through a transmit ring: uartputc() queues a byte and
+// returns, and the transmitter-empty interrupt sends the next bytes,
+// up to a FIFO's worth at a time.  Writers only wait for the UART
+// when the ring is full.  After a panic, bytes go straight to the
+// UART instead, by polling.
 
 #include "types.h"
 #include "defs.h"
@@ -8,20 +14,34 @@
 #include "fs.h"
 #include "file.h"
 #include "mmu.h"
+#include "wait.h"
+#include "signal.h"
 #include "proc.h"
 #include "x86.h"
 
 #define COM1    0x3f8
+#define TXFIFO  16      // bytes the transmit FIFO holds
+#define TXBUF   1024
 
 static int uart;    // is there a uart?
+static int polled;  // panic() has begun; bypass tx and its lock
+
+static struct {
+  struct spinlock lock;
+  char buf[TXBUF];
+  uint r;   // next byte to send
+  uint w;   // next free slot
+} tx;
 
 void
 uartinit(void)
 {
   char *p;
 
-  // Turn off the FIFO
-  outb(COM1+2, 0);
+  initlock(&tx.lock, "uart");
+
+  // Turn on and clear the FIFOs, interrupting on every received byte.
+  outb(COM1+2, 0x07);
   
   // 9600 baud, 8 data bits, 1 stop bit, parity off.
   outb(COM1+3, 0x80);    // Unlock divisor
@@ -29,7 +49,7 @@ uartinit(void)
   outb(COM1+1, 0);
   outb(COM1+3, 0x03);    // Lock divisor, 8 data bits.
   outb(COM1+4, 0);
-  outb(COM1+1, 0x01);    // Enable receive interrupts.
+  outb(COM1+1, 0x03);    // Enable receive and transmit-empty interrupts.
 
   // If status is 0xFF, no serial port.
   if(inb(COM1+5) == 0xFF)
@@ -48,16 +68,74 @@ uartinit(void)
     uartputc(*p);
 }
 
+// Move up to a FIFO's worth of bytes from the ring to the UART.
+static void
+uartsend(void)
+{
+  int i;
+
+  for(i = 0; i < TXFIFO && tx.r != tx.w; i++)
+    outb(COM1+0, tx.buf[tx.r++ % TXBUF]);
+}
+
+// If the transmitter is empty, refill it from the ring.
+// Caller must hold tx.lock.
+static void
+uartstart(void)
+{
+  if(tx.r != tx.w && (inb(COM1+5) & 0x20))
+    uartsend();
+}
+
+// Wait up to about 1ms for the transmitter to empty, giving up
+// on timeout as the polled driver used to.
+static void
+uartwait(void)
+{
+  int i;
+
+  for(i = 0; i < 128 && !(inb(COM1+5) & 0x20); i++)
+    microdelay(10);
+}
+
+// Wait for the transmitter, then refill it.
+static void
+uartpoll(void)
+{
+  uartwait();
+  uartsend();
+}
+
 void
 uartputc(int c)
 {
-  int i;
+  if(!uart)
+    return;
+  if(polled){
+    uartwait();
+    outb(COM1+0, c);
+    return;
+  }
+  acquire(&tx.lock);
+  while(tx.w - tx.r == TXBUF)
+    uartpoll();
+  tx.buf[tx.w++ % TXBUF] = c;
+  uartstart();
+  release(&tx.lock);
+}
 
+// Switch to polled output for panic(), which has turned
+// interrupts off.  tx.lock may be held, perhaps by this CPU, so
+// take no lock: send what is queued, and from now on each byte
+// as it comes.
+void
+uartpanic(void)
+{
   if(!uart)
     return;
-  for(i = 0; i < 128 && !(inb(COM1+5) & 0x20); i++)
-    microdelay(10);
-  outb(COM1+0, c);
+  polled = 1;
+  while(tx.r != tx.w)
+    uartpoll();
 }
 
 static int
@@ -73,5 +151,14 @@ uartgetc(void)
 void
 uartintr(void)
 {
-  consoleintr(uartgetc);
+  // Handle conditions until none is pending, so that the
+  // interrupt line drops and the next one raises a new edge.
+  // Reading the identification register acknowledges
+  // a transmit-empty interrupt.
+  while((inb(COM1+2) & 0x01) == 0){
+    consoleintr(uartgetc);
+    acquire(&tx.lock);
+    uartstart();
+    release(&tx.lock);
+  }
 }
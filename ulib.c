@@ -2,6 +2,7 @@
 #include "stat.h"
 #include "fcntl.h"
 #include "user.h"
+#include "signal.h"
 #include "x86.h"
 
 char*
@@ -49,24 +50,6 @@ strchr(const char *s, char c)
   return 0;
 }
 
-char*
-gets(char *buf, int max)
-{
-  int i, cc;
-  char c;
-
-  for(i=0; i+1 < max; ){
-    cc = read(0, &c, 1);
-    if(cc < 1)
-      break;
-    buf[i++] = c;
-    if(c == '\n' || c == '\r')
-      break;
-  }
-  buf[i] = '\0';
-  return buf;
-}
-
 int
 stat(char *n, struct stat *st)
 {
@@ -103,3 +86,36 @@ memmove(void *vdst, void *vsrc, int n)
     *dst++ = *src++;
   return vdst;
 }
+
+int
+waitpid(int pid, int *status, int options)
+{
+  return wait4(pid, status, options, 0);
+}
+
+// Set the handler for sig, returning the old one.
+sighandler_t
+signal(int sig, sighandler_t handler)
+{
+  struct sigaction sa, osa;
+
+  sa.sa_handler = handler;
+  sa.sa_mask = 0;
+  sa.sa_restorer = (void(*)(void))sigreturn;
+  if(sigaction(sig, &sa, &osa) < 0)
+    return SIG_ERR;
+  return osa.sa_handler;
+}
+
+// Called by exit() before the process ends.  stdio sets it once
+// it has buffered output, so programs that never use stdio (and
+// forktest, which does not link it) pay nothing.
+void (*exithook)(void);
+
+int
+exit(int status)
+{
+  if(exithook)
+    exithook();
+  _exit(status);
+}
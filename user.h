@@ -1,15 +1,18 @@
 struct stat;
 struct rtcdate;
+struct rusage;
+struct sigaction;
+struct hashent;
 
 // system calls
 int fork(void);
-int exit(void) __attribute__((noreturn));
+int _exit(int) __attribute__((noreturn));
 int wait(void);
 int pipe(int*);
 int write(int, void*, int);
 int read(int, void*, int);
 int close(int);
-int kill(int);
+int kill(int, int);
 int exec(char*, char**);
 int open(char*, int);
 int mknod(char*, short, short);
@@ -23,7 +26,24 @@ int getpid(void);
 char* sbrk(int);
 int sleep(int);
 int uptime(void);
-int passHistory(void*);
+int histpush(char*);
+int yield(void);
+int cpustat(uint*, uint*);
+int wait4(int, int*, int, struct rusage*);
+int setpgid(int, int);
+int getpgid(int);
+int killpg(int, int);
+int tcsetpgrp(int);
+int tcgetpgrp(void);
+int sigaction(int, struct sigaction*, struct sigaction*);
+int sigprocmask(int, uint*, uint*);
+int sigreturn(void);
+int lookpath(char*, char*, int);
+int hashstat(struct hashent*, int);
+int rehash(void);
+int execve(char*, char**, char**);
+int lseek(int, int, int);
+int complete(char*);
 
 
 // ulib.c
@@ -32,10 +52,45 @@ char* strcpy(char*, char*);
 void *memmove(void*, void*, int);
 char* strchr(const char*, char c);
 int strcmp(const char*, const char*);
-void printf(int, char*, ...);
-char* gets(char*, int max);
 uint strlen(char*);
 void* memset(void*, int, uint);
 void* malloc(uint);
 void free(void*);
 int atoi(const char*);
+int waitpid(int, int*, int);
+void (*signal(int, void (*)(int)))(int);
+extern void (*exithook)(void);
+int exit(int) __attribute__((noreturn));
+
+// stdio.c
+#define BUFSIZ 512
+#define EOF    (-1)
+#define IONBF  0  // write out at the end of each call
+#define IOLBF  1  // write out at each newline
+#define IOFBF  2  // write out when the buffer is full
+
+typedef struct iobuf {
+  int fd;
+  int mode;             // IONBF, IOLBF or IOFBF
+  int r, n;             // reading: next byte of buf, bytes in buf
+  int w;                // writing: bytes in buf
+  struct iobuf *next;
+  char buf[BUFSIZ];
+} FILE;
+
+extern FILE *stdin, *stdout, *stderr;
+FILE* fdopen(int, int);
+int fclose(FILE*);
+void setvbuf(FILE*, int);
+int fflush(FILE*);
+void fbput(FILE*, int);
+void fdone(FILE*);
+int fputc(int, FILE*);
+int fputs(char*, FILE*);
+int fgetc(FILE*);
+char* fgets(char*, int, FILE*);
+char* gets(char*, int max);
+
+// printf.c
+void printf(int, char*, ...);
+void fprintf(FILE*, char*, ...);
@@ -7,11 +7,14 @@
 #include "syscall.h"
 #include "traps.h"
 #include "memlayout.h"
+#include "wait.h"
+#include "signal.h"
+#include "exechash.h"
 
 char buf[8192];
 char name[3];
 char *echoargv[] = { "echo", "ALL", "TESTS", "PASSED", 0 };
-int stdout = 1;
+#define stdout 1  // an fd here, not user.h's stdio stream
 
 // does chdir() call iput(p->cwd) in a transaction?
 void
@@ -21,19 +24,19 @@ iputtest(void)
 
   if(mkdir("iputdir") < 0){
     printf(stdout, "mkdir failed\n");
-    exit();
+    exit(1);
   }
   if(chdir("iputdir") < 0){
     printf(stdout, "chdir iputdir failed\n");
-    exit();
+    exit(1);
   }
   if(unlink("../iputdir") < 0){
     printf(stdout, "unlink ../iputdir failed\n");
-    exit();
+    exit(1);
   }
   if(chdir("/") < 0){
     printf(stdout, "chdir / failed\n");
-    exit();
+    exit(1);
   }
   printf(stdout, "iput test ok\n");
 }
@@ -49,22 +52,22 @@ exitiputtest(void)
   pid = fork();
   if(pid < 0){
     printf(stdout, "fork failed\n");
-    exit();
+    exit(1);
   }
   if(pid == 0){
     if(mkdir("iputdir") < 0){
       printf(stdout, "mkdir failed\n");
-      exit();
+      exit(1);
     }
     if(chdir("iputdir") < 0){
       printf(stdout, "child chdir failed\n");
-      exit();
+      exit(1);
     }
     if(unlink("../iputdir") < 0){
       printf(stdout, "unlink ../iputdir failed\n");
-      exit();
+      exit(1);
     }
-    exit();
+    exit(0);
   }
   wait();
   printf(stdout, "exitiput test ok\n");
@@ -89,25 +92,25 @@ openiputtest(void)
   printf(stdout, "openiput test\n");
   if(mkdir("oidir") < 0){
     printf(stdout, "mkdir oidir failed\n");
-    exit();
+    exit(1);
   }
   pid = fork();
   if(pid < 0){
     printf(stdout, "fork failed\n");
-    exit();
+    exit(1);
   }
   if(pid == 0){
     int fd = open("oidir", O_RDWR);
     if(fd >= 0){
       printf(stdout, "open directory for write succeeded\n");
-      exit();
+      exit(1);
     }
-    exit();
+    exit(0);
   }
   sleep(1);
   if(unlink("oidir") != 0){
     printf(stdout, "unlink failed\n");
-    exit();
+    exit(1);
   }
   wait();
   printf(stdout, "openiput test ok\n");
@@ -124,13 +127,13 @@ opentest(void)
   fd = open("echo", 0);
   if(fd < 0){
     printf(stdout, "open echo failed!\n");
-    exit();
+    exit(1);
   }
   close(fd);
   fd = open("doesnotexist", 0);
   if(fd >= 0){
     printf(stdout, "open doesnotexist succeeded!\n");
-    exit();
+    exit(1);
   }
   printf(stdout, "open test ok\n");
 }
@@ -147,16 +150,16 @@ writetest(void)
     printf(stdout, "creat small succeeded; ok\n");
   } else {
     printf(stdout, "error: creat small failed!\n");
-    exit();
+    exit(1);
   }
   for(i = 0; i < 100; i++){
     if(write(fd, "aaaaaaaaaa", 10) != 10){
       printf(stdout, "error: write aa %d new file failed\n", i);
-      exit();
+      exit(1);
     }
     if(write(fd, "bbbbbbbbbb", 10) != 10){
       printf(stdout, "error: write bb %d new file failed\n", i);
-      exit();
+      exit(1);
     }
   }
   printf(stdout, "writes ok\n");
@@ -166,20 +169,20 @@ writetest(void)
     printf(stdout, "open small succeeded ok\n");
   } else {
     printf(stdout, "error: open small failed!\n");
-    exit();
+    exit(1);
   }
   i = read(fd, buf, 2000);
   if(i == 2000){
     printf(stdout, "read succeeded ok\n");
   } else {
     printf(stdout, "read failed\n");
-    exit();
+    exit(1);
   }
   close(fd);
 
   if(unlink("small") < 0){
     printf(stdout, "unlink small failed\n");
-    exit();
+    exit(1);
   }
   printf(stdout, "small file test ok\n");
 }
@@ -194,14 +197,14 @@ writetest1(void)
   fd = open("big", O_CREATE|O_RDWR);
   if(fd < 0){
     printf(stdout, "error: creat big failed!\n");
-    exit();
+    exit(1);
   }
 
   for(i = 0; i < MAXFILE; i++){
     ((int*)buf)[0] = i;
     if(write(fd, buf, 512) != 512){
       printf(stdout, "error: write big file failed\n", i);
-      exit();
+      exit(1);
     }
   }
 
@@ -210,7 +213,7 @@ writetest1(void)
   fd = open("big", O_RDONLY);
   if(fd < 0){
     printf(stdout, "error: open big failed!\n");
-    exit();
+    exit(1);
   }
 
   n = 0;
@@ -219,24 +222,24 @@ writetest1(void)
     if(i == 0){
       if(n == MAXFILE - 1){
         printf(stdout, "read only %d blocks from big", n);
-        exit();
+        exit(1);
       }
       break;
     } else if(i != 512){
       printf(stdout, "read failed %d\n", i);
-      exit();
+      exit(1);
     }
     if(((int*)buf)[0] != n){
       printf(stdout, "read content of block %d is %d\n",
              n, ((int*)buf)[0]);
-      exit();
+      exit(1);
     }
     n++;
   }
   close(fd);
   if(unlink("big") < 0){
     printf(stdout, "unlink big failed\n");
-    exit();
+    exit(1);
   }
   printf(stdout, "big files ok\n");
 }
@@ -270,22 +273,22 @@ void dirtest(void)
 
   if(mkdir("dir0") < 0){
     printf(stdout, "mkdir failed\n");
-    exit();
+    exit(1);
   }
 
   if(chdir("dir0") < 0){
     printf(stdout, "chdir dir0 failed\n");
-    exit();
+    exit(1);
   }
 
   if(chdir("..") < 0){
     printf(stdout, "chdir .. failed\n");
-    exit();
+    exit(1);
   }
 
   if(unlink("dir0") < 0){
     printf(stdout, "unlink dir0 failed\n");
-    exit();
+    exit(1);
   }
   printf(stdout, "mkdir test ok\n");
 }
@@ -296,7 +299,7 @@ exectest(void)
   printf(stdout, "exec test\n");
   if(exec("echo", echoargv) < 0){
     printf(stdout, "exec echo failed\n");
-    exit();
+    exit(1);
   }
 }
 
@@ -310,7 +313,7 @@ pipe1(void)
 
   if(pipe(fds) != 0){
     printf(1, "pipe() failed\n");
-    exit();
+    exit(1);
   }
   pid = fork();
   seq = 0;
@@ -321,10 +324,10 @@ pipe1(void)
         buf[i] = seq++;
       if(write(fds[1], buf, 1033) != 1033){
         printf(1, "pipe1 oops 1\n");
-        exit();
+        exit(1);
       }
     }
-    exit();
+    exit(0);
   } else if(pid > 0){
     close(fds[1]);
     total = 0;
@@ -343,13 +346,13 @@ pipe1(void)
     }
     if(total != 5 * 1033){
       printf(1, "pipe1 oops 3 total %d\n", total);
-      exit();
+      exit(1);
     }
     close(fds[0]);
     wait();
   } else {
     printf(1, "fork() failed\n");
-    exit();
+    exit(1);
   }
   printf(1, "pipe1 ok\n");
 }
@@ -390,9 +393,9 @@ preempt(void)
   }
   close(pfds[0]);
   printf(1, "kill... ");
-  kill(pid1);
-  kill(pid2);
-  kill(pid3);
+  kill(pid1, SIGKILL);
+  kill(pid2, SIGKILL);
+  kill(pid3, SIGKILL);
   printf(1, "wait... ");
   wait();
   wait();
@@ -418,12 +421,272 @@ exitwait(void)
         return;
       }
     } else {
-      exit();
+      exit(0);
     }
   }
   printf(1, "exitwait ok\n");
 }
 
+// waitpid() picks the right child, reports its exit status,
+// and does not block with WNOHANG.
+void
+waitpidtest(void)
+{
+  int pid1, pid2, status;
+  struct rusage ru;
+
+  pid1 = fork();
+  if(pid1 == 0){
+    sleep(10);
+    exit(3);
+  }
+  pid2 = fork();
+  if(pid2 == 0)
+    exit(4);
+  if(pid1 < 0 || pid2 < 0){
+    printf(1, "fork failed\n");
+    exit(1);
+  }
+  if(waitpid(pid1, &status, WNOHANG) != 0){
+    printf(1, "waitpid WNOHANG did not return 0\n");
+    exit(1);
+  }
+  if(waitpid(pid2, &status, 0) != pid2 || WEXITSTATUS(status) != 4){
+    printf(1, "waitpid wrong pid or status\n");
+    exit(1);
+  }
+  if(wait4(pid1, &status, 0, &ru) != pid1 || WEXITSTATUS(status) != 3){
+    printf(1, "wait4 wrong pid or status\n");
+    exit(1);
+  }
+  if(waitpid(pid1, &status, 0) != -1){
+    printf(1, "waitpid reaped twice\n");
+    exit(1);
+  }
+  printf(1, "waitpid ok\n");
+}
+
+int gotsig;
+
+void
+sighandler(int sig)
+{
+  gotsig = sig;
+}
+
+// A handler runs for a signal sent by kill(), a blocked signal
+// waits until it is unblocked, and SIGTERM's default action
+// kills a child sleeping in read.
+void
+signaltest(void)
+{
+  uint mask;
+  int fds[2], pid, status;
+
+  printf(1, "signal test\n");
+  gotsig = 0;
+  signal(SIGUSR1, sighandler);
+  kill(getpid(), SIGUSR1);
+  if(gotsig != SIGUSR1){
+    printf(1, "signal handler did not run\n");
+    exit(1);
+  }
+  mask = sigbit(SIGUSR1);
+  sigprocmask(SIG_BLOCK, &mask, 0);
+  gotsig = 0;
+  kill(getpid(), SIGUSR1);
+  if(gotsig != 0){
+    printf(1, "blocked signal delivered\n");
+    exit(1);
+  }
+  sigprocmask(SIG_UNBLOCK, &mask, 0);
+  if(gotsig != SIGUSR1){
+    printf(1, "unblocked signal not delivered\n");
+    exit(1);
+  }
+  signal(SIGUSR1, SIG_DFL);
+
+  if(pipe(fds) != 0){
+    printf(1, "pipe() failed\n");
+    exit(1);
+  }
+  pid = fork();
+  if(pid == 0){
+    read(fds[0], buf, 1);
+    exit(0);
+  }
+  kill(pid, SIGTERM);
+  if(waitpid(pid, &status, 0) != pid || !WIFSIGNALED(status) ||
+     WTERMSIG(status) != SIGTERM){
+    printf(1, "SIGTERM did not kill reader\n");
+    exit(1);
+  }
+  close(fds[0]);
+  close(fds[1]);
+  printf(1, "signal ok\n");
+}
+
+// sh expands variables before braces and wildcards, in every
+// word including the command name.
+void
+shexpandtest(void)
+{
+  char *args[] = { "sh", "-c",
+    "D=expdir; echo $D/*.c > expdir/out; /ech[o] x{1,$D} >> expdir/out", 0 };
+  char buf[64], *want;
+  int pid, status, fd, n;
+
+  printf(1, "sh expand test\n");
+  if(mkdir("expdir") < 0){
+    printf(1, "mkdir expdir failed\n");
+    exit(1);
+  }
+  close(open("expdir/a.c", O_CREATE));
+  close(open("expdir/b.c", O_CREATE));
+  close(open("expdir/c.h", O_CREATE));
+  pid = fork();
+  if(pid == 0){
+    exec("sh", args);
+    exit(1);
+  }
+  if(pid < 0 || waitpid(pid, &status, 0) != pid || WEXITSTATUS(status) != 0){
+    printf(1, "sh -c failed\n");
+    exit(1);
+  }
+  want = "expdir/a.c expdir/b.c\nx1 xexpdir\n";
+  memset(buf, 0, sizeof(buf));
+  if((fd = open("expdir/out", O_RDONLY)) < 0 ||
+     (n = read(fd, buf, sizeof(buf)-1)) < 0 || strcmp(buf, want) != 0){
+    printf(1, "sh expanded to %s\n", buf);
+    exit(1);
+  }
+  close(fd);
+  unlink("expdir/a.c");
+  unlink("expdir/b.c");
+  unlink("expdir/c.h");
+  unlink("expdir/out");
+  unlink("expdir");
+  printf(1, "sh expand ok\n");
+}
+
+// exec's cached command lookups must notice names being
+// created and removed in the search path.
+void
+execcachetest(void)
+{
+  char *args[] = { "xyzzy", 0 };
+  int pid, status;
+
+  printf(1, "execcache test\n");
+  unlink("/xyzzy");
+  if(exec("xyzzy", args) >= 0){
+    printf(1, "exec xyzzy succeeded before link\n");
+    exit(1);
+  }
+  if(link("/echo", "/xyzzy") < 0){
+    printf(1, "link echo xyzzy failed\n");
+    exit(1);
+  }
+  pid = fork();
+  if(pid == 0){
+    close(1);  // keep echo quiet
+    exec("xyzzy", args);
+    exit(7);
+  }
+  if(pid < 0 || waitpid(pid, &status, 0) != pid || WEXITSTATUS(status) != 0){
+    printf(1, "exec xyzzy failed after link\n");
+    exit(1);
+  }
+  unlink("/xyzzy");
+  if(exec("xyzzy", args) >= 0){
+    printf(1, "exec xyzzy succeeded after unlink\n");
+    exit(1);
+  }
+  printf(1, "execcache ok\n");
+}
+
+// Only the shell's group and the foreground group may move the
+// console to another group, and only to a group that exists.
+void
+tcsetpgrptest(void)
+{
+  int pid, status, fg;
+
+  printf(1, "tcsetpgrp test\n");
+  fg = tcgetpgrp();
+  if(tcsetpgrp(1000000) != -1){
+    printf(1, "tcsetpgrp to a missing group succeeded\n");
+    exit(1);
+  }
+  pid = fork();
+  if(pid == 0){
+    setpgid(0, 0);
+    exit(tcsetpgrp(getpid()) == -1 ? 0 : 1);
+  }
+  if(pid < 0 || waitpid(pid, &status, 0) != pid ||
+     WEXITSTATUS(status) != 0 || tcgetpgrp() != fg){
+    printf(1, "background group took the console\n");
+    exit(1);
+  }
+  printf(1, "tcsetpgrp ok\n");
+}
+
+// A directory no one holds open keeps its generation between
+// stats, as the shell's listing cache needs, until it is written.
+void
+dirgentest(void)
+{
+  struct stat st1, st2;
+  int fd;
+
+  printf(1, "dirgen test\n");
+  if(mkdir("dirgen") < 0){
+    printf(1, "mkdir dirgen failed\n");
+    exit(1);
+  }
+  if(stat("dirgen", &st1) < 0 || stat("dirgen", &st2) < 0){
+    printf(1, "stat dirgen failed\n");
+    exit(1);
+  }
+  if(st1.gen != st2.gen){
+    printf(1, "dirgen generation moved without a write\n");
+    exit(1);
+  }
+  if((fd = open("dirgen/f", O_CREATE|O_RDWR)) < 0){
+    printf(1, "create dirgen/f failed\n");
+    exit(1);
+  }
+  close(fd);
+  if(stat("dirgen", &st2) < 0 || st2.gen == st1.gen){
+    printf(1, "dirgen generation unchanged by a new entry\n");
+    exit(1);
+  }
+  unlink("dirgen/f");
+  unlink("dirgen");
+  printf(1, "dirgen ok\n");
+}
+
+// hashstat must check all of the buffer it fills, even for
+// an n whose n*sizeof(struct hashent) wraps around to 4.
+void
+hashstattest(void)
+{
+  struct hashent h[NEXECCACHE];
+  char *top;
+
+  printf(1, "hashstat test\n");
+  if(hashstat(h, 0x7fffffff) < 0){
+    printf(1, "hashstat with large n failed\n");
+    exit(1);
+  }
+  top = sbrk(0);
+  if(hashstat((struct hashent*)(top - 4), 1022611261) != -1){
+    printf(1, "hashstat wrote past the checked buffer\n");
+    exit(1);
+  }
+  printf(1, "hashstat ok\n");
+}
+
 void
 mem(void)
 {
@@ -446,12 +709,12 @@ mem(void)
     m1 = malloc(1024*20);
     if(m1 == 0){
       printf(1, "couldn't allocate mem?!!\n");
-      kill(ppid);
-      exit();
+      kill(ppid, SIGKILL);
+      exit(1);
     }
     free(m1);
     printf(1, "mem ok\n");
-    exit();
+    exit(0);
   } else {
     wait();
   }
@@ -484,7 +747,7 @@ sharedfd(void)
     }
   }
   if(pid == 0)
-    exit();
+    exit(0);
   else
     wait();
   close(fd);
@@ -508,7 +771,7 @@ sharedfd(void)
     printf(1, "sharedfd ok\n");
   } else {
     printf(1, "sharedfd oops %d %d\n", nc, np);
-    exit();
+    exit(1);
   }
 }
 
@@ -530,24 +793,24 @@ fourfiles(void)
     pid = fork();
     if(pid < 0){
       printf(1, "fork failed\n");
-      exit();
+      exit(1);
     }
 
     if(pid == 0){
       fd = open(fname, O_CREATE | O_RDWR);
       if(fd < 0){
         printf(1, "create failed\n");
-        exit();
+        exit(1);
       }
       
       memset(buf, '0'+pi, 512);
       for(i = 0; i < 12; i++){
         if((n = write(fd, buf, 500)) != 500){
           printf(1, "write failed %d\n", n);
-          exit();
+          exit(1);
         }
       }
-      exit();
+      exit(0);
     }
   }
 
@@ -563,7 +826,7 @@ fourfiles(void)
       for(j = 0; j < n; j++){
         if(buf[j] != '0'+i){
           printf(1, "wrong char\n");
-          exit();
+          exit(1);
         }
       }
       total += n;
@@ -571,7 +834,7 @@ fourfiles(void)
     close(fd);
     if(total != 12*500){
       printf(1, "wrong length %d\n", total);
-      exit();
+      exit(1);
     }
     unlink(fname);
   }
@@ -593,7 +856,7 @@ createdelete(void)
     pid = fork();
     if(pid < 0){
       printf(1, "fork failed\n");
-      exit();
+      exit(1);
     }
 
     if(pid == 0){
@@ -604,18 +867,18 @@ createdelete(void)
         fd = open(name, O_CREATE | O_RDWR);
         if(fd < 0){
           printf(1, "create failed\n");
-          exit();
+          exit(1);
         }
         close(fd);
         if(i > 0 && (i % 2 ) == 0){
           name[1] = '0' + (i / 2);
           if(unlink(name) < 0){
             printf(1, "unlink failed\n");
-            exit();
+            exit(1);
           }
         }
       }
-      exit();
+      exit(0);
     }
   }
 
@@ -631,10 +894,10 @@ createdelete(void)
       fd = open(name, 0);
       if((i == 0 || i >= N/2) && fd < 0){
         printf(1, "oops createdelete %s didn't exist\n", name);
-        exit();
+        exit(1);
       } else if((i >= 1 && i < N/2) && fd >= 0){
         printf(1, "oops createdelete %s did exist\n", name);
-        exit();
+        exit(1);
       }
       if(fd >= 0)
         close(fd);
@@ -652,6 +915,80 @@ createdelete(void)
   printf(1, "createdelete ok\n");
 }
 
+void
+lseektest(void)
+{
+  char buf[8];
+  int fd, fds[2];
+
+  printf(1, "lseek test\n");
+  fd = open("lseekfile", O_CREATE|O_RDWR);
+  if(fd < 0 || write(fd, "hello world", 11) != 11){
+    printf(1, "create lseekfile failed\n");
+    exit(1);
+  }
+  memset(buf, 0, sizeof(buf));
+  if(lseek(fd, 6, SEEK_SET) != 6 || read(fd, buf, 5) != 5 ||
+     strcmp(buf, "world") != 0){
+    printf(1, "lseek SEEK_SET failed\n");
+    exit(1);
+  }
+  if(lseek(fd, -11, SEEK_CUR) != 0 || lseek(fd, -5, SEEK_END) != 6 ||
+     lseek(fd, -1, SEEK_SET) != -1 || read(fd, buf, 1) != 1 || buf[0] != 'w'){
+    printf(1, "lseek SEEK_CUR/SEEK_END failed\n");
+    exit(1);
+  }
+  close(fd);
+  unlink("lseekfile");
+  if(pipe(fds) != 0 || lseek(fds[0], 0, SEEK_SET) != -1){
+    printf(1, "lseek on pipe did not fail\n");
+    exit(1);
+  }
+  close(fds[0]);
+  close(fds[1]);
+  printf(1, "lseek ok\n");
+}
+
+// buffered output reaches the file on fflush, fclose and exit,
+// and fgets reads it back a line at a time.
+void
+stdiotest(void)
+{
+  FILE *f;
+  struct stat st;
+  char buf[16];
+  int fd;
+
+  printf(1, "stdio test\n");
+  fd = open("stdiofile", O_CREATE|O_RDWR);
+  if(fd < 0 || (f = fdopen(fd, IOFBF)) == 0){
+    printf(1, "create stdiofile failed\n");
+    exit(1);
+  }
+  fputs("one\n", f);
+  if(fstat(fd, &st) < 0 || st.size != 0 || fflush(f) != 0 ||
+     fstat(fd, &st) < 0 || st.size != 4){
+    printf(1, "stdio fflush failed\n");
+    exit(1);
+  }
+  if(fork() == 0){
+    fputs("two\n", f);
+    exit(0);
+  }
+  wait();
+  fclose(f);
+  if((fd = open("stdiofile", O_RDONLY)) < 0 || (f = fdopen(fd, IOFBF)) == 0 ||
+     fgets(buf, sizeof(buf), f) == 0 || strcmp(buf, "one\n") != 0 ||
+     fgets(buf, sizeof(buf), f) == 0 || strcmp(buf, "two\n") != 0 ||
+     fgets(buf, sizeof(buf), f) != 0){
+    printf(1, "stdio read back failed\n");
+    exit(1);
+  }
+  fclose(f);
+  unlink("stdiofile");
+  printf(1, "stdio ok\n");
+}
+
 // can I unlink a file and still read it?
 void
 unlinkread(void)
@@ -662,7 +999,7 @@ unlinkread(void)
   fd = open("unlinkread", O_CREATE | O_RDWR);
   if(fd < 0){
     printf(1, "create unlinkread failed\n");
-    exit();
+    exit(1);
   }
   write(fd, "hello", 5);
   close(fd);
@@ -670,11 +1007,11 @@ unlinkread(void)
   fd = open("unlinkread", O_RDWR);
   if(fd < 0){
     printf(1, "open unlinkread failed\n");
-    exit();
+    exit(1);
   }
   if(unlink("unlinkread") != 0){
     printf(1, "unlink unlinkread failed\n");
-    exit();
+    exit(1);
   }
 
   fd1 = open("unlinkread", O_CREATE | O_RDWR);
@@ -683,15 +1020,15 @@ unlinkread(void)
 
   if(read(fd, buf, sizeof(buf)) != 5){
     printf(1, "unlinkread read failed");
-    exit();
+    exit(1);
   }
   if(buf[0] != 'h'){
     printf(1, "unlinkread wrong data\n");
-    exit();
+    exit(1);
   }
   if(write(fd, buf, 10) != 10){
     printf(1, "unlinkread write failed\n");
-    exit();
+    exit(1);
   }
   close(fd);
   unlink("unlinkread");
@@ -711,50 +1048,50 @@ linktest(void)
   fd = open("lf1", O_CREATE|O_RDWR);
   if(fd < 0){
     printf(1, "create lf1 failed\n");
-    exit();
+    exit(1);
   }
   if(write(fd, "hello", 5) != 5){
     printf(1, "write lf1 failed\n");
-    exit();
+    exit(1);
   }
   close(fd);
 
   if(link("lf1", "lf2") < 0){
     printf(1, "link lf1 lf2 failed\n");
-    exit();
+    exit(1);
   }
   unlink("lf1");
 
   if(open("lf1", 0) >= 0){
     printf(1, "unlinked lf1 but it is still there!\n");
-    exit();
+    exit(1);
   }
 
   fd = open("lf2", 0);
   if(fd < 0){
     printf(1, "open lf2 failed\n");
-    exit();
+    exit(1);
   }
   if(read(fd, buf, sizeof(buf)) != 5){
     printf(1, "read lf2 failed\n");
-    exit();
+    exit(1);
   }
   close(fd);
 
   if(link("lf2", "lf2") >= 0){
     printf(1, "link lf2 lf2 succeeded! oops\n");
-    exit();
+    exit(1);
   }
 
   unlink("lf2");
   if(link("lf2", "lf1") >= 0){
     printf(1, "link non-existant succeeded! oops\n");
-    exit();
+    exit(1);
   }
 
   if(link(".", "lf1") >= 0){
     printf(1, "link . lf1 succeeded! oops\n");
-    exit();
+    exit(1);
   }
 
   printf(1, "linktest ok\n");
@@ -787,12 +1124,12 @@ concreate(void)
       fd = open(file, O_CREATE | O_RDWR);
       if(fd < 0){
         printf(1, "concreate create %s failed\n", file);
-        exit();
+        exit(1);
       }
       close(fd);
     }
     if(pid == 0)
-      exit();
+      exit(0);
     else
       wait();
   }
@@ -807,11 +1144,11 @@ concreate(void)
       i = de.name[1] - '0';
       if(i < 0 || i >= sizeof(fa)){
         printf(1, "concreate weird file %s\n", de.name);
-        exit();
+        exit(1);
       }
       if(fa[i]){
         printf(1, "concreate duplicate file %s\n", de.name);
-        exit();
+        exit(1);
       }
       fa[i] = 1;
       n++;
@@ -821,7 +1158,7 @@ concreate(void)
 
   if(n != 40){
     printf(1, "concreate not enough files in directory listing\n");
-    exit();
+    exit(1);
   }
 
   for(i = 0; i < 40; i++){
@@ -829,7 +1166,7 @@ concreate(void)
     pid = fork();
     if(pid < 0){
       printf(1, "fork failed\n");
-      exit();
+      exit(1);
     }
     if(((i % 3) == 0 && pid == 0) ||
        ((i % 3) == 1 && pid != 0)){
@@ -844,7 +1181,7 @@ concreate(void)
       unlink(file);
     }
     if(pid == 0)
-      exit();
+      exit(0);
     else
       wait();
   }
@@ -865,7 +1202,7 @@ linkunlink()
   pid = fork();
   if(pid < 0){
     printf(1, "fork failed\n");
-    exit();
+    exit(1);
   }
 
   unsigned int x = (pid ? 1 : 97);
@@ -883,7 +1220,7 @@ linkunlink()
   if(pid)
     wait();
   else 
-    exit();
+    exit(0);
 
   printf(1, "linkunlink ok\n");
 }
@@ -901,7 +1238,7 @@ bigdir(void)
   fd = open("bd", O_CREATE);
   if(fd < 0){
     printf(1, "bigdir create failed\n");
-    exit();
+    exit(1);
   }
   close(fd);
 
@@ -912,7 +1249,7 @@ bigdir(void)
     name[3] = '\0';
     if(link("bd", name) != 0){
       printf(1, "bigdir link failed\n");
-      exit();
+      exit(1);
     }
   }
 
@@ -924,7 +1261,7 @@ bigdir(void)
     name[3] = '\0';
     if(unlink(name) != 0){
       printf(1, "bigdir unlink failed");
-      exit();
+      exit(1);
     }
   }
 
@@ -941,31 +1278,31 @@ subdir(void)
   unlink("ff");
   if(mkdir("dd") != 0){
     printf(1, "subdir mkdir dd failed\n");
-    exit();
+    exit(1);
   }
 
   fd = open("dd/ff", O_CREATE | O_RDWR);
   if(fd < 0){
     printf(1, "create dd/ff failed\n");
-    exit();
+    exit(1);
   }
   write(fd, "ff", 2);
   close(fd);
   
   if(unlink("dd") >= 0){
     printf(1, "unlink dd (non-empty dir) succeeded!\n");
-    exit();
+    exit(1);
   }
 
   if(mkdir("/dd/dd") != 0){
     printf(1, "subdir mkdir dd/dd failed\n");
-    exit();
+    exit(1);
   }
 
   fd = open("dd/dd/ff", O_CREATE | O_RDWR);
   if(fd < 0){
     printf(1, "create dd/dd/ff failed\n");
-    exit();
+    exit(1);
   }
   write(fd, "FF", 2);
   close(fd);
@@ -973,142 +1310,142 @@ subdir(void)
   fd = open("dd/dd/../ff", 0);
   if(fd < 0){
     printf(1, "open dd/dd/../ff failed\n");
-    exit();
+    exit(1);
   }
   cc = read(fd, buf, sizeof(buf));
   if(cc != 2 || buf[0] != 'f'){
     printf(1, "dd/dd/../ff wrong content\n");
-    exit();
+    exit(1);
   }
   close(fd);
 
   if(link("dd/dd/ff", "dd/dd/ffff") != 0){
     printf(1, "link dd/dd/ff dd/dd/ffff failed\n");
-    exit();
+    exit(1);
   }
 
   if(unlink("dd/dd/ff") != 0){
     printf(1, "unlink dd/dd/ff failed\n");
-    exit();
+    exit(1);
   }
   if(open("dd/dd/ff", O_RDONLY) >= 0){
     printf(1, "open (unlinked) dd/dd/ff succeeded\n");
-    exit();
+    exit(1);
   }
 
   if(chdir("dd") != 0){
     printf(1, "chdir dd failed\n");
-    exit();
+    exit(1);
   }
   if(chdir("dd/../../dd") != 0){
     printf(1, "chdir dd/../../dd failed\n");
-    exit();
+    exit(1);
   }
   if(chdir("dd/../../../dd") != 0){
     printf(1, "chdir dd/../../dd failed\n");
-    exit();
+    exit(1);
   }
   if(chdir("./..") != 0){
     printf(1, "chdir ./.. failed\n");
-    exit();
+    exit(1);
   }
 
   fd = open("dd/dd/ffff", 0);
   if(fd < 0){
     printf(1, "open dd/dd/ffff failed\n");
-    exit();
+    exit(1);
   }
   if(read(fd, buf, sizeof(buf)) != 2){
     printf(1, "read dd/dd/ffff wrong len\n");
-    exit();
+    exit(1);
   }
   close(fd);
 
   if(open("dd/dd/ff", O_RDONLY) >= 0){
     printf(1, "open (unlinked) dd/dd/ff succeeded!\n");
-    exit();
+    exit(1);
   }
 
   if(open("dd/ff/ff", O_CREATE|O_RDWR) >= 0){
     printf(1, "create dd/ff/ff succeeded!\n");
-    exit();
+    exit(1);
   }
   if(open("dd/xx/ff", O_CREATE|O_RDWR) >= 0){
     printf(1, "create dd/xx/ff succeeded!\n");
-    exit();
+    exit(1);
   }
   if(open("dd", O_CREATE) >= 0){
     printf(1, "create dd succeeded!\n");
-    exit();
+    exit(1);
   }
   if(open("dd", O_RDWR) >= 0){
     printf(1, "open dd rdwr succeeded!\n");
-    exit();
+    exit(1);
   }
   if(open("dd", O_WRONLY) >= 0){
     printf(1, "open dd wronly succeeded!\n");
-    exit();
+    exit(1);
   }
   if(link("dd/ff/ff", "dd/dd/xx") == 0){
     printf(1, "link dd/ff/ff dd/dd/xx succeeded!\n");
-    exit();
+    exit(1);
   }
   if(link("dd/xx/ff", "dd/dd/xx") == 0){
     printf(1, "link dd/xx/ff dd/dd/xx succeeded!\n");
-    exit();
+    exit(1);
   }
   if(link("dd/ff", "dd/dd/ffff") == 0){
     printf(1, "link dd/ff dd/dd/ffff succeeded!\n");
-    exit();
+    exit(1);
   }
   if(mkdir("dd/ff/ff") == 0){
     printf(1, "mkdir dd/ff/ff succeeded!\n");
-    exit();
+    exit(1);
   }
   if(mkdir("dd/xx/ff") == 0){
     printf(1, "mkdir dd/xx/ff succeeded!\n");
-    exit();
+    exit(1);
   }
   if(mkdir("dd/dd/ffff") == 0){
     printf(1, "mkdir dd/dd/ffff succeeded!\n");
-    exit();
+    exit(1);
   }
   if(unlink("dd/xx/ff") == 0){
     printf(1, "unlink dd/xx/ff succeeded!\n");
-    exit();
+    exit(1);
   }
   if(unlink("dd/ff/ff") == 0){
     printf(1, "unlink dd/ff/ff succeeded!\n");
-    exit();
+    exit(1);
   }
   if(chdir("dd/ff") == 0){
     printf(1, "chdir dd/ff succeeded!\n");
-    exit();
+    exit(1);
   }
   if(chdir("dd/xx") == 0){
     printf(1, "chdir dd/xx succeeded!\n");
-    exit();
+    exit(1);
   }
 
   if(unlink("dd/dd/ffff") != 0){
     printf(1, "unlink dd/dd/ff failed\n");
-    exit();
+    exit(1);
   }
   if(unlink("dd/ff") != 0){
     printf(1, "unlink dd/ff failed\n");
-    exit();
+    exit(1);
   }
   if(unlink("dd") == 0){
     printf(1, "unlink non-empty dd succeeded!\n");
-    exit();
+    exit(1);
   }
   if(unlink("dd/dd") < 0){
     printf(1, "unlink dd/dd failed\n");
-    exit();
+    exit(1);
   }
   if(unlink("dd") < 0){
     printf(1, "unlink dd failed\n");
-    exit();
+    exit(1);
   }
 
   printf(1, "subdir ok\n");
@@ -1127,14 +1464,14 @@ bigwrite(void)
     fd = open("bigwrite", O_CREATE | O_RDWR);
     if(fd < 0){
       printf(1, "cannot create bigwrite\n");
-      exit();
+      exit(1);
     }
     int i;
     for(i = 0; i < 2; i++){
       int cc = write(fd, buf, sz);
       if(cc != sz){
         printf(1, "write(%d) ret %d\n", sz, cc);
-        exit();
+        exit(1);
       }
     }
     close(fd);
@@ -1155,13 +1492,13 @@ bigfile(void)
   fd = open("bigfile", O_CREATE | O_RDWR);
   if(fd < 0){
     printf(1, "cannot create bigfile");
-    exit();
+    exit(1);
   }
   for(i = 0; i < 20; i++){
     memset(buf, i, 600);
     if(write(fd, buf, 600) != 600){
       printf(1, "write bigfile failed\n");
-      exit();
+      exit(1);
     }
   }
   close(fd);
@@ -1169,31 +1506,31 @@ bigfile(void)
   fd = open("bigfile", 0);
   if(fd < 0){
     printf(1, "cannot open bigfile\n");
-    exit();
+    exit(1);
   }
   total = 0;
   for(i = 0; ; i++){
     cc = read(fd, buf, 300);
     if(cc < 0){
       printf(1, "read bigfile failed\n");
-      exit();
+      exit(1);
     }
     if(cc == 0)
       break;
     if(cc != 300){
       printf(1, "short read bigfile\n");
-      exit();
+      exit(1);
     }
     if(buf[0] != i/2 || buf[299] != i/2){
       printf(1, "read bigfile wrong data\n");
-      exit();
+      exit(1);
     }
     total += cc;
   }
   close(fd);
   if(total != 20*600){
     printf(1, "read bigfile wrong total\n");
-    exit();
+    exit(1);
   }
   unlink("bigfile");
 
@@ -1210,32 +1547,32 @@ fourteen(void)
 
   if(mkdir("12345678901234") != 0){
     printf(1, "mkdir 12345678901234 failed\n");
-    exit();
+    exit(1);
   }
   if(mkdir("12345678901234/123456789012345") != 0){
     printf(1, "mkdir 12345678901234/123456789012345 failed\n");
-    exit();
+    exit(1);
   }
   fd = open("123456789012345/123456789012345/123456789012345", O_CREATE);
   if(fd < 0){
     printf(1, "create 123456789012345/123456789012345/123456789012345 failed\n");
-    exit();
+    exit(1);
   }
   close(fd);
   fd = open("12345678901234/12345678901234/12345678901234", 0);
   if(fd < 0){
     printf(1, "open 12345678901234/12345678901234/12345678901234 failed\n");
-    exit();
+    exit(1);
   }
   close(fd);
 
   if(mkdir("12345678901234/12345678901234") == 0){
     printf(1, "mkdir 12345678901234/12345678901234 succeeded!\n");
-    exit();
+    exit(1);
   }
   if(mkdir("123456789012345/12345678901234") == 0){
     printf(1, "mkdir 12345678901234/123456789012345 succeeded!\n");
-    exit();
+    exit(1);
   }
 
   printf(1, "fourteen ok\n");
@@ -1247,35 +1584,35 @@ rmdot(void)
   printf(1, "rmdot test\n");
   if(mkdir("dots") != 0){
     printf(1, "mkdir dots failed\n");
-    exit();
+    exit(1);
   }
   if(chdir("dots") != 0){
     printf(1, "chdir dots failed\n");
-    exit();
+    exit(1);
   }
   if(unlink(".") == 0){
     printf(1, "rm . worked!\n");
-    exit();
+    exit(1);
   }
   if(unlink("..") == 0){
     printf(1, "rm .. worked!\n");
-    exit();
+    exit(1);
   }
   if(chdir("/") != 0){
     printf(1, "chdir / failed\n");
-    exit();
+    exit(1);
   }
   if(unlink("dots/.") == 0){
     printf(1, "unlink dots/. worked!\n");
-    exit();
+    exit(1);
   }
   if(unlink("dots/..") == 0){
     printf(1, "unlink dots/.. worked!\n");
-    exit();
+    exit(1);
   }
   if(unlink("dots") != 0){
     printf(1, "unlink dots failed!\n");
-    exit();
+    exit(1);
   }
   printf(1, "rmdot ok\n");
 }
@@ -1290,49 +1627,49 @@ dirfile(void)
   fd = open("dirfile", O_CREATE);
   if(fd < 0){
     printf(1, "create dirfile failed\n");
-    exit();
+    exit(1);
   }
   close(fd);
   if(chdir("dirfile") == 0){
     printf(1, "chdir dirfile succeeded!\n");
-    exit();
+    exit(1);
   }
   fd = open("dirfile/xx", 0);
   if(fd >= 0){
     printf(1, "create dirfile/xx succeeded!\n");
-    exit();
+    exit(1);
   }
   fd = open("dirfile/xx", O_CREATE);
   if(fd >= 0){
     printf(1, "create dirfile/xx succeeded!\n");
-    exit();
+    exit(1);
   }
   if(mkdir("dirfile/xx") == 0){
     printf(1, "mkdir dirfile/xx succeeded!\n");
-    exit();
+    exit(1);
   }
   if(unlink("dirfile/xx") == 0){
     printf(1, "unlink dirfile/xx succeeded!\n");
-    exit();
+    exit(1);
   }
   if(link("README", "dirfile/xx") == 0){
     printf(1, "link to dirfile/xx succeeded!\n");
-    exit();
+    exit(1);
   }
   if(unlink("dirfile") != 0){
     printf(1, "unlink dirfile failed!\n");
-    exit();
+    exit(1);
   }
 
   fd = open(".", O_RDWR);
   if(fd >= 0){
     printf(1, "open . for writing succeeded!\n");
-    exit();
+    exit(1);
   }
   fd = open(".", 0);
   if(write(fd, "x", 1) > 0){
     printf(1, "write . succeeded!\n");
-    exit();
+    exit(1);
   }
   close(fd);
 
@@ -1347,15 +1684,15 @@ iref(void)
 
   printf(1, "empty file name\n");
 
-  // the 50 is NINODE
+  // more than the 50 inodes the old fixed icache held
   for(i = 0; i < 50 + 1; i++){
     if(mkdir("irefd") != 0){
       printf(1, "mkdir irefd failed\n");
-      exit();
+      exit(1);
     }
     if(chdir("irefd") != 0){
       printf(1, "chdir irefd failed\n");
-      exit();
+      exit(1);
     }
 
     mkdir("");
@@ -1383,29 +1720,30 @@ forktest(void)
 
   printf(1, "fork test\n");
 
+  // more than NPROC processes
   for(n=0; n<1000; n++){
     pid = fork();
     if(pid < 0)
       break;
     if(pid == 0)
-      exit();
+      exit(0);
   }
   
   if(n == 1000){
     printf(1, "fork claimed to work 1000 times!\n");
-    exit();
+    exit(1);
   }
   
   for(; n > 0; n--){
     if(wait() < 0){
       printf(1, "wait stopped early\n");
-      exit();
+      exit(1);
     }
   }
   
   if(wait() != -1){
     printf(1, "wait got too many\n");
-    exit();
+    exit(1);
   }
   
   printf(1, "fork test OK\n");
@@ -1428,7 +1766,7 @@ sbrktest(void)
     b = sbrk(1);
     if(b != a){
       printf(stdout, "sbrk test failed %d %x %x\n", i, a, b);
-      exit();
+      exit(1);
     }
     *b = 1;
     a = b + 1;
@@ -1436,16 +1774,16 @@ sbrktest(void)
   pid = fork();
   if(pid < 0){
     printf(stdout, "sbrk test fork failed\n");
-    exit();
+    exit(1);
   }
   c = sbrk(1);
   c = sbrk(1);
   if(c != a + 1){
     printf(stdout, "sbrk test failed post-fork\n");
-    exit();
+    exit(1);
   }
   if(pid == 0)
-    exit();
+    exit(0);
   wait();
 
   // can one grow address space to something big?
@@ -1455,7 +1793,7 @@ sbrktest(void)
   p = sbrk(amt);
   if (p != a) { 
     printf(stdout, "sbrk test failed to grow big address space; enough phys mem?\n");
-    exit();
+    exit(1);
   }
   lastaddr = (char*) (BIG-1);
   *lastaddr = 99;
@@ -1465,12 +1803,12 @@ sbrktest(void)
   c = sbrk(-4096);
   if(c == (char*)0xffffffff){
     printf(stdout, "sbrk could not deallocate\n");
-    exit();
+    exit(1);
   }
   c = sbrk(0);
   if(c != a - 4096){
     printf(stdout, "sbrk deallocation produced wrong address, a %x c %x\n", a, c);
-    exit();
+    exit(1);
   }
 
   // can one re-allocate that page?
@@ -1478,19 +1816,19 @@ sbrktest(void)
   c = sbrk(4096);
   if(c != a || sbrk(0) != a + 4096){
     printf(stdout, "sbrk re-allocation failed, a %x c %x\n", a, c);
-    exit();
+    exit(1);
   }
   if(*lastaddr == 99){
     // should be zero
     printf(stdout, "sbrk de-allocation didn't really deallocate\n");
-    exit();
+    exit(1);
   }
 
   a = sbrk(0);
   c = sbrk(-(sbrk(0) - oldbrk));
   if(c != a){
     printf(stdout, "sbrk downsize failed, a %x c %x\n", a, c);
-    exit();
+    exit(1);
   }
   
   // can we read the kernel's memory?
@@ -1499,12 +1837,12 @@ sbrktest(void)
     pid = fork();
     if(pid < 0){
       printf(stdout, "fork failed\n");
-      exit();
+      exit(1);
     }
     if(pid == 0){
       printf(stdout, "oops could read %x = %x\n", a, *a);
-      kill(ppid);
-      exit();
+      kill(ppid, SIGKILL);
+      exit(1);
     }
     wait();
   }
@@ -1513,7 +1851,7 @@ sbrktest(void)
   // failed allocation?
   if(pipe(fds) != 0){
     printf(1, "pipe() failed\n");
-    exit();
+    exit(1);
   }
   for(i = 0; i < sizeof(pids)/sizeof(pids[0]); i++){
     if((pids[i] = fork()) == 0){
@@ -1532,12 +1870,12 @@ sbrktest(void)
   for(i = 0; i < sizeof(pids)/sizeof(pids[0]); i++){
     if(pids[i] == -1)
       continue;
-    kill(pids[i]);
+    kill(pids[i], SIGKILL);
     wait();
   }
   if(c == (char*)0xffffffff){
     printf(stdout, "failed sbrk leaked memory\n");
-    exit();
+    exit(1);
   }
 
   if(sbrk(0) > oldbrk)
@@ -1572,17 +1910,17 @@ validatetest(void)
     if((pid = fork()) == 0){
       // try to crash the kernel by passing in a badly placed integer
       validateint((int*)p);
-      exit();
+      exit(0);
     }
     sleep(0);
     sleep(0);
-    kill(pid);
+    kill(pid, SIGKILL);
     wait();
 
     // try to crash the kernel by passing in a bad string pointer
     if(link("nosuchfile", (char*)p) != -1){
       printf(stdout, "link should not succeed\n");
-      exit();
+      exit(1);
     }
   }
 
@@ -1600,7 +1938,7 @@ bsstest(void)
   for(i = 0; i < sizeof(uninit); i++){
     if(uninit[i] != '\0'){
       printf(stdout, "bss test failed\n");
-      exit();
+      exit(1);
     }
   }
   printf(stdout, "bss test ok\n");
@@ -1627,16 +1965,16 @@ bigargtest(void)
     printf(stdout, "bigarg test ok\n");
     fd = open("bigarg-ok", O_CREATE);
     close(fd);
-    exit();
+    exit(0);
   } else if(pid < 0){
     printf(stdout, "bigargtest: fork failed\n");
-    exit();
+    exit(1);
   }
   wait();
   fd = open("bigarg-ok", 0);
   if(fd < 0){
     printf(stdout, "bigarg test failed!\n");
-    exit();
+    exit(1);
   }
   close(fd);
   unlink("bigarg-ok");
@@ -1710,7 +2048,7 @@ main(int argc, char *argv[])
 
   if(open("usertests.ran", 0) >= 0){
     printf(1, "already ran user tests -- rebuild fs.img\n");
-    exit();
+    exit(1);
   }
   close(open("usertests.ran", O_CREATE));
 
@@ -1740,6 +2078,13 @@ main(int argc, char *argv[])
   pipe1();
   preempt();
   exitwait();
+  waitpidtest();
+  signaltest();
+  execcachetest();
+  shexpandtest();
+  tcsetpgrptest();
+  hashstattest();
+  dirgentest();
 
   rmdot();
   fourteen();
@@ -1747,11 +2092,13 @@ main(int argc, char *argv[])
   subdir();
   linktest();
   unlinkread();
+  lseektest();
+  stdiotest();
   dirfile();
   iref();
   forktest();
   bigdir(); // slow
   exectest();
 
-  exit();
+  exit(0);
 }
@@ -1,3 +0,0 @@
-#include "var_in_kernel.h"
-
-struct history hs;
@@ -1,9 +0,0 @@
-#ifndef VAR_IN_KERNEL_H
-#define VAR_IN_KERNEL_H
-
-#include "history.h"
-
-extern struct history hs;
-
-
-#endif
@@ -4,6 +4,8 @@
 #include "x86.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "wait.h"
+#include "signal.h"
 #include "proc.h"
 #include "elf.h"
 
@@ -49,6 +51,8 @@ walkpgdir(pde_t *pgdir, const void *va, int alloc)
   pte_t *pgtab;
 
   pde = &pgdir[PDX(va)];
+  if(*pde & PTE_PS)
+    return 0;  // 4 MB superpage: there is no page table to walk.
   if(*pde & PTE_P){
     pgtab = (pte_t*)p2v(PTE_ADDR(*pde));
   } else {
@@ -89,6 +93,39 @@ mappages(pde_t *pgdir, void *va, uint size, uint pa, int perm)
   return 0;
 }
 
+// Like mappages, but use 4 MB superpages (PTE_PS) for every
+// 4 MB-aligned stretch of at least 4 MB, so that big direct
+// mappings need neither page-table pages nor 1024 TLB entries
+// per 4 MB. Whatever is left at either end gets 4 KB pages.
+// Needs CR4_PSE, which entry.S and entryother.S turn on.
+static int
+mapbigpages(pde_t *pgdir, void *va, uint size, uint pa, int perm)
+{
+  char *a;
+  uint n;
+
+  a = (char*)va;
+  while(size > 0){
+    if((uint)a % SUPERPGSIZE == 0 && pa % SUPERPGSIZE == 0 &&
+       size >= SUPERPGSIZE){
+      if(pgdir[PDX(a)] & PTE_P)
+        panic("remap");
+      pgdir[PDX(a)] = pa | perm | PTE_P | PTE_PS;
+      n = SUPERPGSIZE;
+    } else {
+      n = SUPERPGSIZE - (uint)a % SUPERPGSIZE;
+      if(n > size)
+        n = size;
+      if(mappages(pgdir, a, n, pa, perm) < 0)
+        return -1;
+    }
+    a += n;
+    pa += n;
+    size -= n;
+  }
+  return 0;
+}
+
 // There is one page table per process, plus one that's used when
 // a CPU is not running any process (kpgdir). The kernel uses the
 // current process's page table during system calls and interrupts;
@@ -106,6 +143,10 @@ mappages(pde_t *pgdir, void *va, uint size, uint pa, int perm)
 //                                  rw data + free physical memory
 //   0xfe000000..0: mapped direct (devices such as ioapic)
 //
+// Mappings in the kernel half use 4 MB superpages wherever they are
+// 4 MB aligned (see mapbigpages), which keeps the per-process cost of
+// the kernel mappings down to the page directory and one page table.
+//
 // The kernel allocates physical memory for its heap and for user memory
 // between V2P(end) and the end of physical memory (PHYSTOP)
 // (directly addressable from end..P2V(PHYSTOP)).
@@ -137,8 +178,8 @@ setupkvm(void)
   if (p2v(PHYSTOP) > (void*)DEVSPACE)
     panic("PHYSTOP too high");
   for(k = kmap; k < &kmap[NELEM(kmap)]; k++)
-    if(mappages(pgdir, k->virt, k->phys_end - k->phys_start, 
-                (uint)k->phys_start, k->perm) < 0)
+    if(mapbigpages(pgdir, k->virt, k->phys_end - k->phys_start, 
+                   (uint)k->phys_start, k->perm) < 0)
       return 0;
   return pgdir;
 }
@@ -149,7 +190,23 @@ void
 kvmalloc(void)
 {
   kpgdir = setupkvm();
-  switchkvm();
+  lcr3(v2p(kpgdir));   // cpu is not set up yet, so not switchkvm()
+}
+
+// Load pgdir into %cr3 unless this CPU already has it loaded.
+// Every reload flushes the TLB, so skipping it lets a process
+// that is rescheduled on the same CPU keep its TLB entries.
+// A CPU keeps a process's page table loaded only while it runs
+// that process or holds ptable.lock in scheduler(), so nobody
+// can free a page table that is still loaded somewhere.
+static void
+loadpgdir(pde_t *pgdir)
+{
+  if(cpu->pgdir == pgdir)
+    return;
+  lcr3(v2p(pgdir));
+  cpu->pgdir = pgdir;
+  cpu->ntlbflush++;
 }
 
 // Switch h/w page table register to the kernel-only page table,
@@ -157,7 +214,18 @@ kvmalloc(void)
 void
 switchkvm(void)
 {
-  lcr3(v2p(kpgdir));   // switch to the kernel page table
+  loadpgdir(kpgdir);   // switch to the kernel page table
+}
+
+// Flush this CPU's TLB after mappings have been removed
+// from the page table it has loaded.
+void
+flushtlb(void)
+{
+  pushcli();
+  lcr3(v2p(cpu->pgdir));
+  cpu->ntlbflush++;
+  popcli();
 }
 
 // Switch TSS and h/w page table to correspond to process p.
@@ -172,7 +240,7 @@ switchuvm(struct proc *p)
   ltr(SEG_TSS << 3);
   if(p->pgdir == 0)
     panic("switchuvm: no pgdir");
-  lcr3(v2p(p->pgdir));  // switch to new address space
+  loadpgdir(p->pgdir);  // switch to new address space
   popcli();
 }
 
@@ -283,7 +351,7 @@ freevm(pde_t *pgdir)
     panic("freevm: no pgdir");
   deallocuvm(pgdir, KERNBASE, 0);
   for(i = 0; i < NPDENTRIES; i++){
-    if(pgdir[i] & PTE_P){
+    if((pgdir[i] & (PTE_P|PTE_PS)) == PTE_P){
       char * v = p2v(PTE_ADDR(pgdir[i]));
       kfree(v);
     }
@@ -344,7 +412,7 @@ uva2ka(pde_t *pgdir, char *uva)
   pte_t *pte;
 
   pte = walkpgdir(pgdir, uva, 0);
-  if((*pte & PTE_P) == 0)
+  if(pte == 0 || (*pte & PTE_P) == 0)
     return 0;
   if((*pte & PTE_U) == 0)
     return 0;
@@ -0,0 +1,23 @@
+// Options and status encoding for wait4() and waitpid().
+
+#define WNOHANG   1 // Return 0 instead of sleeping if no child has exited
+#define WUNTRACED 2 // Also report children that have stopped
+
+// A child that calls exit(n) is reported with status n<<8;
+// a child killed by signal sig is reported with status sig;
+// a child stopped by signal sig is reported with sig<<8 | 0x7f.
+#define WIFEXITED(s)    (((s) & 0x7f) == 0)
+#define WEXITSTATUS(s)  (((s) >> 8) & 0xff)
+#define WIFSIGNALED(s)  (((s) & 0x7f) != 0 && ((s) & 0x7f) != 0x7f)
+#define WTERMSIG(s)     ((s) & 0x7f)
+#define WIFSTOPPED(s)   (((s) & 0xff) == 0x7f)
+#define WSTOPSIG(s)     (((s) >> 8) & 0xff)
+
+// Resources used by a process and the children it has waited for.
+struct rusage {
+  uint ticks;    // Clock ticks spent running
+  uint pgfault;  // Fatal page faults: without demand paging, a user
+                 // fault kills the process, so 0 or 1 per process
+  uint inblock;  // Disk blocks read
+  uint oublock;  // Disk blocks written
+};